@@ -0,0 +1,49 @@
+#!/bin/bash
+
+# Usage: ./bench.sh [functions] [runs] [configuration]...
+# Generates a large source file and measures the end-to-end compile time
+# of every configuration, each one is a quoted list of compiler options:
+#   ./bench.sh 20000 3 "-O2" "-O2 -per-function-opt"
+# Peak memory is reported as well if GNU time is installed.
+# Set EXE to compare against another build, e.g. EXE=old/exe ./bench.sh
+
+EXE=${EXE:-build/exe}
+FUNCS=${1:-20000}
+RUNS=${2:-3}
+CONFIGS=("${@:3}")
+SRC=build/bench/large.cc
+
+if [ ${#CONFIGS[@]} -eq 0 ]
+then
+    CONFIGS=("")
+fi
+
+echo "Generating $SRC with $FUNCS functions..."  && \
+mkdir -p build/bench                             && \
+{
+    sed '/^void main/,$d' tests/Basic/Test1/test.cc
+    for ((i = 0; i < FUNCS; ++i))
+    do
+        printf 'int f%d(int a, int b)\n{\n' $i
+        printf '    int c = a * %d + b, d[4];\n' $i
+        printf '    /* keep the scanner busy with comments */\n'
+        printf '    while (c > 0)\n    {\n        c -= b + 1;\n        d[c %% 4] = c << 1;\n    }\n'
+        printf '    return c + d[0];\n}\n\n'
+    done
+    printf 'void main(void)\n{\n    output(f0(input(), 1));\n}\n'
+} > $SRC                                         || exit 1
+
+TIMEFORMAT="%R s"
+for config in "${CONFIGS[@]}"
+do
+    echo "Compiling $SRC with $EXE $config ($RUNS runs)..."
+    for ((i = 0; i < RUNS; ++i))
+    do
+        if [ -x /usr/bin/time ]
+        then
+            /usr/bin/time -f "%e s, %M KB peak" $EXE $config $SRC 2>&1 >/dev/null | tail -1
+        else
+            time $EXE $config $SRC 2>/dev/null
+        fi
+    done
+done
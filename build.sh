@@ -1,5 +1,13 @@
 #!/bin/bash
 
+LIB_SOURCES="src/Compiler.cpp src/Cache.cpp src/Incremental.cpp
+             src/Scanner/Lexer.cpp src/Parser/parse.cc src/AST/AST.cpp
+             src/Backend/Target.cpp src/Backend/Optimizer.cpp src/Backend/JIT.cpp
+             src/Server/Server.cpp src/Server/ForkServer.cpp"
+CXXFLAGS="`llvm-config --cxxflags` -O0 -g -fexceptions -std=c++17 -Wall"
+LDFLAGS="`llvm-config --ldflags --system-libs                               \
+                      --libs core bitreader bitwriter linker native ipo orcjit`"
+
 echo "Running flex..."                                                  && \
 flexc++ src/Scanner/Scanner.l --target-directory=src/Scanner            && \
 
@@ -7,9 +15,26 @@ echo "Running bison..."                                                 && \
 bisonc++ src/Parser/Parser.y --target-directory=src/Parser              && \
 cat src/Parser/Hack >> src/Parser/parse.cc                              && \
 
+echo "Compiling the library..."                                         && \
+mkdir -p build/lib                                                      && \
+for src in $LIB_SOURCES
+do
+    clang++ $CXXFLAGS -c $src -o build/lib/`basename $src`.o || exit 1
+done                                                                    && \
+rm -f build/libcompiler.a                                               && \
+ar rcs build/libcompiler.a build/lib/*.o                                && \
+
 echo "Compiling..."                                                     && \
-clang++ `llvm-config --cxxflags --ldflags --system-libs --libs core`       \
-        -O0 -g -fexceptions -std=c++17 -Wall -o build/exe src/Main.cpp     \
-        src/Scanner/lex.cc src/Parser/parse.cc src/AST/AST.cpp          && \
+# The build ID identifies the code of the compiler in the keys of the cache
+clang++ $CXXFLAGS -Wl,--build-id -o build/exe src/Main.cpp build/libcompiler.a $LDFLAGS && \
+clang++ $CXXFLAGS -o build/client src/Client.cpp                         && \
+clang++ $CXXFLAGS -o build/test-runner src/TestRunner.cpp build/libcompiler.a $LDFLAGS && \
+clang++ $CXXFLAGS -O2 -o build/generate src/Generate.cpp                 && \
+# The benchmarked components are built again with optimizations
+clang++ $CXXFLAGS -O2 -o build/microbench src/MicroBench.cpp src/Scanner/lex.cc \
+        src/Scanner/Lexer.cpp src/Parser/parse.cc src/AST/AST.cpp $LDFLAGS && \
+# The flexc++ scanner is only kept to test the Lexer against it
+clang++ $CXXFLAGS -o build/scanner-test src/ScannerTest.cpp src/Scanner/lex.cc \
+        src/Scanner/Lexer.cpp $LDFLAGS                                   && \
 
 echo "Done!"
@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# Usage: ./fork-bench.sh [requests] [options]...
+# Compiles tests/Basic/Test1 `requests` times one after another, once by
+# starting build/exe for each compilation and once by sending the requests
+# to build/exe --fork-server, and prints the average latency of both:
+#   ./fork-bench.sh 200 -O2 -c
+# Set EXE to measure another build.
+
+EXE=${EXE:-build/exe}
+REQUESTS=${1:-200}
+OPTIONS="${@:2}"
+DIR=build/fork-bench
+SRC=$DIR/test.cc
+
+mkdir -p $DIR && cp tests/Basic/Test1/test.cc $SRC || exit 1
+
+# Prints the average microseconds per request of a run taking $1 nanoseconds
+average()
+{
+    echo "$(( $1 / REQUESTS / 1000 )) us per compilation"
+}
+
+echo "Starting $EXE $OPTIONS $REQUESTS times..."
+START=$(date +%s%N)
+for ((i = 0; i < REQUESTS; ++i))
+do
+    $EXE $OPTIONS $SRC 2>/dev/null
+done
+average $(( $(date +%s%N) - START ))
+
+echo "Sending $REQUESTS requests to $EXE --fork-server..."
+START=$(date +%s%N)
+for ((i = 0; i < REQUESTS; ++i))
+do
+    echo "$OPTIONS $SRC"
+done | $EXE --fork-server 2>/dev/null | grep -vc '^0$' | sed 's/^/Failed requests: /'
+average $(( $(date +%s%N) - START ))
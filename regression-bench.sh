@@ -0,0 +1,122 @@
+#!/bin/bash
+
+# Usage: ./regression-bench.sh [-update]
+# Runs throughput-bench.sh and runtime-bench.sh, collects the IR metrics of
+# every test in tests/Basic after code generation and after -O2, writes them
+# all to build/bench/results.json and compares them with $BASELINE:
+#   THRESHOLD=10 ./regression-bench.sh
+# The exit status is 1 if a compile or run time or the peak memory grew by
+# more than THRESHOLD percent, an IR metric by more than IR_THRESHOLD percent,
+# or a result of the baseline is missing. -update replaces the baseline with
+# the new results instead, the times only compare well on the same machine.
+# SCALE, RUNS and OPTIONS are passed to throughput-bench.sh, RUNS and LEVELS
+# to runtime-bench.sh, and EXE, GENERATE and CC to both.
+
+EXE=${EXE:-build/exe}
+BASELINE=${BASELINE:-tests/Bench/baseline.json}
+THRESHOLD=${THRESHOLD:-10}
+IR_THRESHOLD=${IR_THRESHOLD:-0}
+SCALE=${SCALE:-0.1}
+RUNS=${RUNS:-3}
+LEVELS=${LEVELS:--O0 -O2}
+# Time differences below this many seconds are noise
+MIN_SECONDS=${MIN_SECONDS:-0.01}
+DIR=build/bench
+RESULTS=$DIR/results.json
+
+if [ $# -gt 1 ] || { [ $# -eq 1 ] && [ "$1" != -update ]; }
+then
+    echo "Usage: $0 [-update]"
+    exit 1
+fi
+
+export EXE
+./throughput-bench.sh $SCALE $RUNS $OPTIONS || exit 1
+echo
+./runtime-bench.sh $RUNS $LEVELS
+echo
+
+# One metric per line, so that the results can be compared with awk
+{
+    echo "{"
+    sed -n 's/^  {"name": "\([a-z]*\)", "lines": [0-9]*, "tokens": [0-9]*, "seconds": \([-0-9.e]*\),.*/  "throughput.\1.seconds": \2,/p' \
+        $DIR/throughput.json
+    sed -n 's/^  {"name": "\([a-z]*\)", .*"peak_rss_kb": \([0-9]*\).*/  "throughput.\1.peak_rss_kb": \2,/p' \
+        $DIR/throughput.json
+    sed -n 's/.*"kernel": "\([A-Za-z]*\)", "level": "\([-A-Za-z0-9]*\)", "seconds": \([0-9.nul]*\),.*/  "runtime.\1\2.seconds": \3,/p' \
+        $DIR/runtime.json
+    for test in tests/Basic/*/test.cc
+    do
+        name=`basename $(dirname $test)`
+        # The modules are reported after code generation and after optimization
+        $EXE -O2 -mem-report -o /dev/null $test 2>&1 | \
+        sed -n 's/^LLVM modules after \([a-z]*\): [0-9]* modules, [0-9]* functions, \([0-9]*\) basic blocks, \([0-9]*\) instructions, \([0-9]*\) allocas, \([0-9]*\) loads, \([0-9]*\) stores$/\1 \2 \3 \4 \5 \6/p' | \
+        while read stage blocks instructions allocas loads stores
+        do
+            echo "  \"ir.$name.$stage.basic_blocks\": $blocks,"
+            echo "  \"ir.$name.$stage.instructions\": $instructions,"
+            echo "  \"ir.$name.$stage.allocas\": $allocas,"
+            echo "  \"ir.$name.$stage.loads\": $loads,"
+            echo "  \"ir.$name.$stage.stores\": $stores,"
+        done
+    done
+} | sed '$s/,$//' > $RESULTS
+echo "}" >> $RESULTS
+echo "The results are in $RESULTS"
+
+if [ "$1" == -update ]
+then
+    cp $RESULTS $BASELINE && echo "Updated $BASELINE"
+    exit
+fi
+if [ ! -f $BASELINE ]
+then
+    echo "Error: $BASELINE does not exist, create it with -update"
+    exit 1
+fi
+
+# Prints the metrics that changed past their threshold, and fails on regressions
+awk -v threshold=$THRESHOLD -v irThreshold=$IR_THRESHOLD -v minSeconds=$MIN_SECONDS '
+    function metric(line)
+    {
+        if (!match(line, /"[^"]*": /))
+            return 0
+        key = substr(line, RSTART + 1, RLENGTH - 4)
+        value = substr(line, RSTART + RLENGTH)
+        sub(/,$/, "", value)
+        return 1
+    }
+    FNR == NR { if (metric($0)) { baseline[key] = value; order[++count] = key } next }
+    { if (metric($0)) results[key] = value }
+    END {
+        regressions = improvements = 0
+        printf "%-44s %12s %12s %9s\n", "Metric", "Baseline", "Now", "Change"
+        for (i = 1; i <= count; ++i)
+        {
+            key = order[i]
+            old = baseline[key]
+            if (!(key in results) || results[key] == "null")
+            {
+                printf "%-44s %12s %12s %9s\n", key, old, (key in results) ? "wrong" : "missing", "FAIL"
+                ++regressions
+                continue
+            }
+            now = results[key]
+            if (old == "null" || old == now)
+                continue
+            limit = key ~ /^ir\./ ? irThreshold : threshold
+            change = old == 0 ? 100 : (now - old) * 100 / old
+            noise = key ~ /seconds$/ && now - old < minSeconds && old - now < minSeconds
+            if (noise || (change <= limit && -change <= limit))
+                continue
+            status = change > 0 ? "FAIL" : "better"
+            printf "%-44s %12s %12s %+8.1f%% %s\n", key, old, now, change, status
+            if (change > 0)
+                ++regressions
+            else
+                ++improvements
+        }
+        printf "%d regressions, %d improvements past the thresholds of %s%% and %s%% for the IR\n",
+               regressions, improvements, threshold, irThreshold
+        exit regressions > 0
+    }' $BASELINE $RESULTS
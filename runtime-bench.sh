@@ -0,0 +1,77 @@
+#!/bin/bash
+
+# Usage: ./runtime-bench.sh [runs] [levels]...
+# Compiles every kernel in tests/Bench at every optimization level, once with
+# build/exe and once as C with $CC, runs both `runs` times, checks the output
+# against <kernel>/test.cc.out and prints the fastest run of each:
+#   ./runtime-bench.sh 3 -O0 -O2
+# The default levels are -O0 to -O3. The results are also written to
+# build/bench/runtime.json, and the exit status is 1 if any output is wrong.
+# Set EXE to time the code of another build, and CC to compare with another
+# C compiler, clang by default like build.sh.
+
+EXE=${EXE:-build/exe}
+CC=${CC:-clang}
+RUNS=${1:-3}
+LEVELS=("${@:2}")
+DIR=build/bench/runtime
+JSON=build/bench/runtime.json
+
+if [ ${#LEVELS[@]} -eq 0 ]
+then
+    LEVELS=(-O0 -O1 -O2 -O3)
+fi
+
+# Prints the seconds of the fastest of $RUNS runs of $1, or "wrong" if an output differs from $2
+run()
+{
+    local best= start end seconds i
+    for ((i = 0; i < RUNS; ++i))
+    do
+        start=`date +%s%N`
+        $1 > $1.out || { echo wrong; return; }
+        end=`date +%s%N`
+        cmp -s $1.out $2 || { echo wrong; return; }
+        seconds=`awk "BEGIN { printf \"%.4f\", ($end - $start) / 1e9 }"`
+        if [ -z "$best" ] || awk "BEGIN { exit !($seconds < $best) }"
+        then
+            best=$seconds
+        fi
+    done
+    echo $best
+}
+
+mkdir -p $DIR || exit 1
+failed=0
+first=1
+echo "{\"cc\": \"`$CC --version | head -1`\", \"results\": [" > $JSON
+printf "%-12s %-6s %10s %10s %8s\n" Kernel Level "Ours (s)" "$CC (s)" Ratio
+for test in tests/Bench/*/test.cc
+do
+    name=`basename $(dirname $test)`
+    for level in "${LEVELS[@]}"
+    do
+        bin=$DIR/$name$level
+        # The C build renames main(), whose return type is void in the kernels
+        $EXE $level -c -o $bin.o $test 2>/dev/null && $CC $bin.o -o $bin                     && \
+        $CC -x c -w $level -Dmain=kernel -c -o $bin.c.o $test                              && \
+        $CC $bin.c.o tests/Bench/driver.c -o $bin.c                                        || exit 1
+        ours=`run $bin $test.out`
+        theirs=`run $bin.c $test.out`
+        if [ $ours == wrong ] || [ $theirs == wrong ]
+        then
+            failed=1
+            ratio=wrong
+        else
+            ratio=`awk "BEGIN { printf \"%.2f\", $ours / $theirs }"`
+        fi
+        printf "%-12s %-6s %10s %10s %8s\n" $name $level $ours $theirs $ratio
+        [ $first -eq 0 ] && echo "," >> $JSON
+        first=0
+        # A wrong output is recorded as null
+        printf '  {"kernel": "%s", "level": "%s", "seconds": %s, "cc_seconds": %s}' $name $level \
+               `echo $ours | sed 's/wrong/null/'` `echo $theirs | sed 's/wrong/null/'` >> $JSON
+    done
+done
+echo -e "\n]}" >> $JSON
+exit $failed
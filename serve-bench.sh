@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# Usage: ./serve-bench.sh [requests] [concurrency] [options]...
+# Compiles the test programs `requests` times, `concurrency` at a time, once
+# with a new build/exe process per file and once through build/client with
+# a compile server, and prints the time of both:
+#   ./serve-bench.sh 2000 8 -O2 -c
+# Set EXE and CLIENT to compare other builds.
+
+EXE=${EXE:-build/exe}
+CLIENT=${CLIENT:-build/client}
+REQUESTS=${1:-1000}
+CONCURRENCY=${2:-4}
+OPTIONS="${@:3}"
+DIR=build/serve-bench
+SOCKET=$DIR/server.sock
+
+echo "Copying $REQUESTS test programs to $DIR..."  && \
+rm -rf $DIR && mkdir -p $DIR                     && \
+TESTS=(tests/Basic/*/test.cc)                    && \
+for ((i = 0; i < REQUESTS; ++i))
+do
+    cp ${TESTS[i % ${#TESTS[@]}]} $DIR/$i.cc
+done                                             || exit 1
+
+TIMEFORMAT="%R s"
+echo "One $EXE process per file, $CONCURRENCY at a time..."
+time (ls $DIR/*.cc | xargs -P $CONCURRENCY -I{} $EXE $OPTIONS {} 2>/dev/null)
+
+$EXE -j $CONCURRENCY --serve $SOCKET 2>/dev/null &
+SERVER=$!
+trap "kill $SERVER" EXIT
+while [ ! -S $SOCKET ]
+do
+    sleep 0.1
+done
+echo "One $CLIENT request per file, $CONCURRENCY at a time..."
+time (ls $DIR/*.cc | xargs -P $CONCURRENCY -I{} $CLIENT $SOCKET $OPTIONS {} 2>/dev/null)
@@ -14,6 +14,7 @@
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Transforms/InstCombine/InstCombine.h>
 #include <llvm/Transforms/Scalar.h>
@@ -25,6 +26,8 @@
 #include <iostream>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include "../SymbolTable.hpp"
 #include "../ErrorHandler.hpp"
 
@@ -48,17 +51,38 @@ namespace ast
     public:
         virtual ~Base() = default;
 
+        // Size of every node allocated on this thread by address, while -mem-report tracks them
+        inline static std::unordered_map<void *, size_t> *&TrackedNodes()
+        {
+            thread_local std::unordered_map<void *, size_t> *nodes = nullptr;
+            return nodes;
+        }
+        inline static void *operator new(size_t size)
+        {
+            auto p = ::operator new(size);
+            if (auto nodes = TrackedNodes())
+                nodes->emplace(p, size);
+            return p;
+        }
+        inline static void operator delete(void *p)
+        {
+            if (auto nodes = TrackedNodes())
+                nodes->erase(p);
+            ::operator delete(p);
+        }
+
         inline virtual void Show(std::ostream &os = std::cout, const std::string &hint = "") const {}
     };
 
     class ID : public Base
     {
     private:
-        std::string _ID;
+        // Points into the source, which outlives the AST
+        std::string_view _ID;
         ErrorHandler::Location _Location;
 
     public:
-        inline explicit ID(const std::string &id, const ErrorHandler::Location &loc)
+        inline explicit ID(std::string_view id, const ErrorHandler::Location &loc)
             : _ID(id), _Location(loc) {}
 
         inline virtual void Show(std::ostream &os, const std::string &hint) const override
@@ -66,7 +90,7 @@ namespace ast
             os << hint << "ID: " << _ID << '\n';
         }
 
-        inline std::string GetName() const { return _ID; }
+        inline std::string GetName() const { return std::string(_ID); }
         inline const ErrorHandler::Location &GetLocation() const { return _Location; }
     };
 
@@ -13,8 +13,11 @@ namespace ast
     class Declaration : public Statement
     {
     public:
-        inline virtual bool CodeGen(SymbolTable &syms, llvm::LLVMContext &context,
-                                    llvm::Module &mod, llvm::IRBuilder<> &builder) = 0;
+        // If `functionPM` is not nullptr, it runs on every function right after it is generated
+        inline virtual bool CodeGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::Module &mod,
+                                    llvm::IRBuilder<> &builder, llvm::legacy::FunctionPassManager *functionPM) = 0;
+        // Names visible to the following declarations
+        inline virtual arr<std::string> GetNames() const = 0;
     };
 
     class VarDeclaration : public Declaration
@@ -29,6 +32,14 @@ namespace ast
         inline void AddVar(ptr<Base> &var) { _VarList.push_back(to<InitDecl>(var)); }
         inline void SetType(ptr<Base> &type) { _Type = to<TypePrimitive>(type); }
 
+        inline virtual arr<std::string> GetNames() const override
+        {
+            arr<std::string> names;
+            for (const auto &var : _VarList)
+                names.push_back(var->GetVar()->GetName());
+            return names;
+        }
+
         inline virtual void Show(std::ostream &os, const std::string &hint = "") const override
         {
             os << hint << "VarDeclaration: \n";
@@ -41,8 +52,8 @@ namespace ast
             }
         }
 
-        inline virtual bool CodeGen(SymbolTable &syms, llvm::LLVMContext &context,
-                                    llvm::Module &mod, llvm::IRBuilder<> &builder) override
+        inline virtual bool CodeGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::Module &mod,
+                                    llvm::IRBuilder<> &builder, llvm::legacy::FunctionPassManager *functionPM) override
         {
             auto type = _Type->TypeGen(context);
             bool success = true;
@@ -69,11 +80,23 @@ namespace ast
         ptr<TypePrimitive> _Type;
         ptr<Decl> _FuncDecl;
         ptr<StatementList> _Body;
+        // Only the prototype is generated, the body is linked in from another module
+        bool _SkipBody = false;
 
     public:
         inline explicit FuncDeclaration(ptr<Base> &type, ptr<Base> &funcDecl, ptr<Base> &body)
             : _Type(to<TypePrimitive>(type)), _FuncDecl(to<Decl>(funcDecl)), _Body(to<StatementList>(body)) {}
 
+        inline virtual arr<std::string> GetNames() const override { return {_FuncDecl->GetName()}; }
+        inline void SkipBody() { _SkipBody = true; }
+
+        // The user's main is renamed, `main` is the entry generated by DeclarationList
+        inline std::string GetSymbolName() const
+        {
+            auto name = _FuncDecl->GetName();
+            return name == "main" ? "__main__" : name;
+        }
+
         inline virtual void Show(std::ostream &os, const std::string &hint = "") const override
         {
             os << hint << "FuncDeclaration: \n";
@@ -85,12 +108,10 @@ namespace ast
             _Body->Show(os, hint + "\t\t");
         }
 
-        inline virtual bool CodeGen(SymbolTable &syms, llvm::LLVMContext &context,
-                                    llvm::Module &mod, llvm::IRBuilder<> &builder) override
+        inline virtual bool CodeGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::Module &mod,
+                                    llvm::IRBuilder<> &builder, llvm::legacy::FunctionPassManager *functionPM) override
         {
-            auto name = _FuncDecl->GetName();
-            if (name == "main")
-                name = "__main__";
+            auto name = GetSymbolName();
             // TODO: Check return type and parameters of main function
             // but it seems to work well with arbitary return type and parameters of main function
             if (!syms.TryAddSymbol(name))
@@ -109,6 +130,9 @@ namespace ast
                 return false;
             auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, mod);
             syms.AddSymbol(name, f);
+            if (_SkipBody)
+                return true;
+            llvm::TimeTraceScope trace("CodeGen Function", name);
             auto *entryBB = llvm::BasicBlock::Create(context, "entry", f);
             llvm::IRBuilder<> bbBuilder(context);
             bbBuilder.SetInsertPoint(entryBB);
@@ -121,6 +145,10 @@ namespace ast
                 bbBuilder.CreateRet(nullptr);
             else
                 bbBuilder.CreateRet(llvm::Constant::getNullValue(retTy));
+            // Optimize while the function is still hot in cache,
+            // invalid IR is left for the module verifier to report
+            if (functionPM && !llvm::verifyFunction(*f))
+                functionPM->run(*f);
             return true;
         }
 
@@ -135,11 +163,16 @@ namespace ast
     {
     private:
         arr<ptr<Declaration>> _DeclList;
+        // Sizes of the symbol tables of the last CodeGen()
+        size_t _SymbolScopes = 0, _SymbolCount = 0;
 
     public:
         inline explicit DeclarationList(ptr<Base> &decl) { _DeclList.push_back(to<Declaration>(decl)); }
 
         inline void AddDecl(ptr<Base> &decl) { _DeclList.push_back(to<Declaration>(decl)); }
+        inline const arr<ptr<Declaration>> &GetDecls() const { return _DeclList; }
+        inline size_t GetSymbolScopes() const { return _SymbolScopes; }
+        inline size_t GetSymbolCount() const { return _SymbolCount; }
 
         inline virtual void Show(std::ostream &os, const std::string &hint = "") const override
         {
@@ -150,10 +183,13 @@ namespace ast
             }
         }
 
-        inline bool CodeGen(llvm::LLVMContext &context, llvm::Module &mod)
+        inline bool CodeGen(llvm::LLVMContext &context, llvm::Module &mod,
+                            llvm::legacy::FunctionPassManager *functionPM = nullptr)
         {
             SymbolTable syms;
-            llvm::FunctionType *entryFT = llvm::FunctionType::get(llvm::Type::getVoidTy(context), false);
+            // The entry returns the result of an int main and 0 otherwise, which is the exit status of
+            // natively linked programs and of --run
+            llvm::FunctionType *entryFT = llvm::FunctionType::get(llvm::Type::getInt32Ty(context), false);
             llvm::Function *entryF = llvm::Function::Create(entryFT, llvm::Function::ExternalLinkage, "main", &mod);
             llvm::BasicBlock *entryBB = llvm::BasicBlock::Create(context, "entry", entryF);
             llvm::IRBuilder<> builder(context);
@@ -161,8 +197,10 @@ namespace ast
 
             bool success = true;
             for (auto &i : _DeclList)
-                if (!i->CodeGen(syms, context, mod, builder))
+                if (!i->CodeGen(syms, context, mod, builder, functionPM))
                     success = false;
+            _SymbolScopes = syms.CountScopes();
+            _SymbolCount = syms.CountSymbols();
 
             auto func = mod.getFunction("__main__");
             if (!func)
@@ -177,8 +215,11 @@ namespace ast
                 auto c = llvm::Constant::getNullValue(t);
                 args.push_back(c);
             }
-            builder.CreateCall(func, args);
-            builder.CreateRet(nullptr);
+            auto result = builder.CreateCall(func, args);
+            if (func->getReturnType() == entryFT->getReturnType())
+                builder.CreateRet(result);
+            else
+                builder.CreateRet(llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), 0));
             return success;
         }
     };
@@ -30,6 +30,7 @@ namespace ast
 
         inline virtual bool StmtGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::IRBuilder<> &builder) override
         {
+            llvm::TimeTraceScope trace("ExprStmt", "");
             if (!_Expr)
                 return true;
             if (_Expr->CodeGen(syms, context, builder))
@@ -66,6 +67,7 @@ namespace ast
 
         inline virtual bool StmtGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::IRBuilder<> &builder) override
         {
+            llvm::TimeTraceScope trace("IfStmt", "");
             auto func = builder.GetInsertBlock()->getParent();
 
             auto thenBB = llvm::BasicBlock::Create(context, "if.then", func, 0);
@@ -116,6 +118,7 @@ namespace ast
 
         inline virtual bool StmtGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::IRBuilder<> &builder) override
         {
+            llvm::TimeTraceScope trace("WhileStmt", "");
             auto func = builder.GetInsertBlock()->getParent();
 
             auto condBB = llvm::BasicBlock::Create(context, "while.cond", func, 0);
@@ -171,6 +174,7 @@ namespace ast
 
         inline virtual bool StmtGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::IRBuilder<> &builder) override
         {
+            llvm::TimeTraceScope trace("ForStmt", "");
             auto func = builder.GetInsertBlock()->getParent();
 
             auto condBB = llvm::BasicBlock::Create(context, "for.cond", func, 0);
@@ -226,6 +230,7 @@ namespace ast
 
         inline virtual bool StmtGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::IRBuilder<> &builder) override
         {
+            llvm::TimeTraceScope trace("ReturnStmt", "");
             auto func = builder.GetInsertBlock()->getParent();
 
             if (!_Expr && func->getReturnType()->isVoidTy())
@@ -284,6 +289,7 @@ namespace ast
 
         inline virtual bool StmtGen(SymbolTable &syms, llvm::LLVMContext &context, llvm::IRBuilder<> &builder) override
         {
+            llvm::TimeTraceScope trace("StatementList", "");
             bool success = true;
             auto child = syms.AddChild();
             for (auto &i : _StatementList)
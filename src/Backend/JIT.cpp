@@ -0,0 +1,229 @@
+#include "JIT.hpp"
+
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Support/Error.h>
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Target.hpp"
+#include "../ErrorHandler.hpp"
+
+namespace backend
+{
+    static std::nullopt_t PrintError(llvm::Error err)
+    {
+        ErrorHandler::Stream() << "Error: " << llvm::toString(std::move(err)) << '\n';
+        return std::nullopt;
+    }
+
+    std::optional<int> JIT::Run(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> mod,
+                                const std::map<std::string, void *> &symbols, const Caller &call)
+    {
+        Target::InitializeNative();
+
+        auto jit = llvm::orc::LLJITBuilder().create();
+        if (!jit)
+            return PrintError(jit.takeError());
+        // Unresolved symbols are reported here before the lookup fails, by default to llvm::errs()
+        (*jit)->getExecutionSession().setErrorReporter([](llvm::Error err) { PrintError(std::move(err)); });
+
+        auto generator = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            (*jit)->getDataLayout().getGlobalPrefix());
+        if (!generator)
+            return PrintError(generator.takeError());
+        (*jit)->getMainJITDylib().addGenerator(std::move(*generator));
+        // Definitions of the dylib are found before the generator is asked
+        llvm::orc::SymbolMap defined;
+        for (const auto &[name, address] : symbols)
+            defined[(*jit)->mangleAndIntern(name)] =
+                llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(address), llvm::JITSymbolFlags::Exported);
+        if (!defined.empty())
+            if (auto err = (*jit)->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(defined))))
+                return PrintError(std::move(err));
+
+        if (auto err = (*jit)->addIRModule(llvm::orc::ThreadSafeModule(std::move(mod), std::move(context))))
+            return PrintError(std::move(err));
+        auto sym = (*jit)->lookup("main");
+        if (!sym)
+            return PrintError(sym.takeError());
+        auto entry = reinterpret_cast<int (*)()>(sym->getAddress());
+        if (call)
+            return call(entry);
+        return entry();
+    }
+
+    // Compiles likely callees in the background, so that the first call does not wait for them
+    class Speculator
+    {
+    private:
+        llvm::orc::LLLazyJIT &_JIT;
+        // Created by the compile-on-demand layer when the first partition is emitted
+        llvm::orc::JITDylib *_ImplDylib = nullptr;
+        // Direct callees defined in the module, by caller
+        std::map<std::string, std::vector<std::string>> _Callees;
+        std::set<std::string> _Queued;
+        std::deque<llvm::orc::SymbolStringPtr> _Queue;
+        std::vector<std::thread> _Workers;
+        std::mutex _Mutex;
+        std::condition_variable _Ready;
+        bool _Stopped = false;
+
+        inline void Work()
+        {
+            while (true)
+            {
+                llvm::orc::SymbolStringPtr name;
+                {
+                    std::unique_lock<std::mutex> lock(_Mutex);
+                    _Ready.wait(lock, [this] { return _Stopped || !_Queue.empty(); });
+                    if (_Stopped)
+                        return;
+                    name = std::move(_Queue.front());
+                    _Queue.pop_front();
+                }
+                // Looking up the body, not the lazy stub, materializes the function on
+                // the compile threads of the JIT. Failures are reported again when
+                // the program calls the function
+                auto sym = _JIT.getExecutionSession().lookup({_ImplDylib}, name);
+                if (!sym)
+                    llvm::consumeError(sym.takeError());
+            }
+        }
+
+    public:
+        inline explicit Speculator(llvm::orc::LLLazyJIT &jit, const llvm::Module &mod, unsigned int threads)
+            : _JIT(jit)
+        {
+            for (const auto &f : mod)
+                for (const auto &bb : f)
+                    for (const auto &inst : bb)
+                        if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst))
+                            if (auto callee = call->getCalledFunction())
+                                if (!callee->isDeclaration())
+                                    _Callees[f.getName().str()].push_back(callee->getName().str());
+            for (unsigned int i = 0; i < threads; ++i)
+                _Workers.emplace_back([this] { Work(); });
+        }
+
+        inline ~Speculator() { Stop(); }
+
+        // Joins the workers, after which nothing more is queued. The lookups of the workers
+        // have returned, but the compile threads of the JIT may still be running
+        inline void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_Mutex);
+                _Stopped = true;
+            }
+            _Ready.notify_all();
+            for (auto &t : _Workers)
+                t.join();
+            _Workers.clear();
+        }
+
+        // Called when `func` is about to be compiled, queues its callees
+        inline void Compiling(const std::string &func)
+        {
+            auto iter = _Callees.find(func);
+            if (iter == _Callees.end())
+                return;
+            std::lock_guard<std::mutex> lock(_Mutex);
+            if (_Stopped)
+                return;
+            // Function bodies live in the implementation dylib of the compile-on-demand layer
+            if (!_ImplDylib)
+                _ImplDylib = _JIT.getExecutionSession().getJITDylibByName(_JIT.getMainJITDylib().getName() + ".impl");
+            if (!_ImplDylib)
+                return;
+            for (const auto &callee : iter->second)
+                if (_Queued.insert(callee).second)
+                {
+                    _Queue.push_back(_JIT.mangleAndIntern(callee));
+                    _Ready.notify_one();
+                }
+        }
+    };
+
+    // Called instead of a function whose code could not be generated on its first call,
+    // after the error was reported. The program cannot continue without it
+    [[noreturn]] static void LazyCompileFailed()
+    {
+        std::exit(1);
+    }
+
+    std::optional<int> JIT::RunLazy(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> mod,
+                                    const Optimizer &optimizer, unsigned int speculateThreads)
+    {
+        Target::InitializeNative();
+
+        // With compile threads the JIT creates a TargetMachine per compilation,
+        // the single shared one is not thread-safe
+        auto jit = llvm::orc::LLLazyJITBuilder()
+                       .setNumCompileThreads(speculateThreads)
+                       .setLazyCompileFailureAddr(llvm::pointerToJITTargetAddress(&LazyCompileFailed))
+                       .create();
+        if (!jit)
+            return PrintError(jit.takeError());
+        // Unresolved symbols are reported here before the lookup fails, by default to llvm::errs()
+        (*jit)->getExecutionSession().setErrorReporter([](llvm::Error err) { PrintError(std::move(err)); });
+
+        auto generator = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            (*jit)->getDataLayout().getGlobalPrefix());
+        if (!generator)
+            return PrintError(generator.takeError());
+        (*jit)->getMainJITDylib().addGenerator(std::move(*generator));
+
+        // One partition per function, instead of the whole module at the first call
+        (*jit)->setPartitionFunction(llvm::orc::CompileOnDemandLayer::compileRequested);
+
+        // Shared with the transform, which keeps it alive until the JIT is destroyed:
+        // ~LLJIT waits for its compile threads before it destroys the transform layer
+        struct LazyState
+        {
+            std::unique_ptr<Speculator> Speculation;
+            // The optimizer shares the TargetMachine of the driver
+            std::mutex OptimizerMutex;
+        };
+        auto state = std::make_shared<LazyState>();
+        if (speculateThreads > 0)
+            state->Speculation = std::make_unique<Speculator>(**jit, *mod, speculateThreads);
+        // The transform layer sees each partition right before it is compiled,
+        // possibly on several compile threads at once
+        (*jit)->getIRTransformLayer().setTransform(
+            [&optimizer, state](llvm::orc::ThreadSafeModule tsm, const llvm::orc::MaterializationResponsibility &)
+                -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+                tsm.withModuleDo([&](llvm::Module &partition) {
+                    if (state->Speculation)
+                        for (const auto &f : partition)
+                            if (!f.isDeclaration())
+                                state->Speculation->Compiling(f.getName().str());
+                    std::lock_guard<std::mutex> lock(state->OptimizerMutex);
+                    optimizer.Run(partition);
+                });
+                return std::move(tsm);
+            });
+
+        std::optional<int> result;
+        if (auto err = (*jit)->addLazyIRModule(llvm::orc::ThreadSafeModule(std::move(mod), std::move(context))))
+            result = PrintError(std::move(err));
+        else if (auto sym = (*jit)->lookup("main"))
+            result = reinterpret_cast<int (*)()>(sym->getAddress())();
+        else
+            result = PrintError(sym.takeError());
+        // Stop speculating on every path before the JIT goes away
+        if (state->Speculation)
+            state->Speculation->Stop();
+        return result;
+    }
+} // namespace backend
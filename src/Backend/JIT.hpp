@@ -0,0 +1,36 @@
+#pragma once
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include "Optimizer.hpp"
+
+namespace backend
+{
+    // Executes generated modules in-process with an ORC JIT
+    class JIT
+    {
+    public:
+        // Calls the compiled `main`, e.g. in a child process, and returns its result
+        using Caller = std::function<std::optional<int>(int (*main)())>;
+
+        // Compiles the module and calls the `main` generated by DeclarationList::CodeGen.
+        // External functions such as getchar and putchar are resolved against this process,
+        // unless `symbols` gives their address, e.g. to capture the output of the program.
+        // `call` calls `main` instead of calling it directly.
+        // Returns the result of `main`, or std::nullopt after printing the error
+        static std::optional<int> Run(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> mod,
+                                      const std::map<std::string, void *> &symbols = {}, const Caller &call = nullptr);
+
+        // Same as Run(), but every function is optimized and compiled only when it is first called.
+        // If `speculateThreads` is not 0, the direct callees of each compiled function
+        // are compiled ahead of time on that many background threads
+        static std::optional<int> RunLazy(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> mod,
+                                          const Optimizer &optimizer, unsigned int speculateThreads);
+    };
+} // namespace backend
@@ -0,0 +1,105 @@
+#include "Optimizer.hpp"
+
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/AlwaysInliner.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Scalar/GVN.h>
+#include <llvm/Transforms/Utils.h>
+
+namespace backend
+{
+    void Optimizer::Populate(llvm::legacy::PassManager &modulePM, llvm::legacy::FunctionPassManager &functionPM) const
+    {
+        if (_Machine)
+        {
+            modulePM.add(llvm::createTargetTransformInfoWrapperPass(_Machine->getTargetIRAnalysis()));
+            functionPM.add(llvm::createTargetTransformInfoWrapperPass(_Machine->getTargetIRAnalysis()));
+        }
+
+        llvm::PassManagerBuilder builder;
+        // -Os optimizes like -O2 but prefers smaller code
+        builder.OptLevel = _SizeLevel > 0 ? 2 : _OptLevel;
+        builder.SizeLevel = _SizeLevel;
+        if (builder.OptLevel > 1)
+            builder.Inliner = llvm::createFunctionInliningPass(builder.OptLevel, builder.SizeLevel, false);
+        else
+            builder.Inliner = llvm::createAlwaysInlinerLegacyPass();
+        builder.LoopVectorize = builder.OptLevel > 1 && builder.SizeLevel < 2;
+        builder.SLPVectorize = builder.OptLevel > 1 && builder.SizeLevel < 2;
+        if (_Machine)
+            _Machine->adjustPassManager(builder);
+
+        builder.populateFunctionPassManager(functionPM);
+        builder.populateModulePassManager(modulePM);
+    }
+
+    void Optimizer::Run(llvm::Module &mod) const
+    {
+        if (!IsEnabled())
+            return;
+        llvm::legacy::PassManager modulePM;
+        llvm::legacy::FunctionPassManager functionPM(&mod);
+        Populate(modulePM, functionPM);
+
+        functionPM.doInitialization();
+        for (auto &f : mod)
+            functionPM.run(f);
+        functionPM.doFinalization();
+        modulePM.run(mod);
+    }
+
+    void Optimizer::PopulatePerFunction(llvm::legacy::FunctionPassManager &functionPM) const
+    {
+        if (!IsEnabled())
+            return;
+        if (_Machine)
+            functionPM.add(llvm::createTargetTransformInfoWrapperPass(_Machine->getTargetIRAnalysis()));
+
+        // Promote allocas to registers first, everything else depends on it
+        functionPM.add(llvm::createSROAPass());
+        functionPM.add(llvm::createEarlyCSEPass());
+        functionPM.add(llvm::createInstructionCombiningPass());
+        functionPM.add(llvm::createReassociatePass());
+        functionPM.add(llvm::createGVNPass());
+        functionPM.add(llvm::createCFGSimplificationPass());
+        if (_OptLevel < 2)
+            return;
+        // Loop passes, loop-simplify and LCSSA are scheduled by the pass manager
+        functionPM.add(llvm::createLICMPass());
+        functionPM.add(llvm::createIndVarSimplifyPass());
+        functionPM.add(llvm::createLoopDeletionPass());
+        if (_SizeLevel == 0)
+            functionPM.add(llvm::createLoopUnrollPass(_OptLevel));
+        functionPM.add(llvm::createInstructionCombiningPass());
+        functionPM.add(llvm::createGVNPass());
+        functionPM.add(llvm::createDeadStoreEliminationPass());
+        functionPM.add(llvm::createCFGSimplificationPass());
+    }
+
+    void Optimizer::RunInterprocedural(llvm::Module &mod) const
+    {
+        if (!IsEnabled())
+            return;
+        llvm::legacy::PassManager modulePM;
+        if (_Machine)
+            modulePM.add(llvm::createTargetTransformInfoWrapperPass(_Machine->getTargetIRAnalysis()));
+        modulePM.add(llvm::createIPSCCPPass());
+        modulePM.add(llvm::createGlobalOptimizerPass());
+        modulePM.add(llvm::createDeadArgEliminationPass());
+        if (_OptLevel > 1 || _SizeLevel > 0)
+        {
+            modulePM.add(llvm::createFunctionInliningPass(_SizeLevel > 0 ? 2 : _OptLevel, _SizeLevel, false));
+            // Cleans up each function after its callees were inlined into it
+            modulePM.add(llvm::createSROAPass());
+            modulePM.add(llvm::createInstructionCombiningPass());
+            modulePM.add(llvm::createCFGSimplificationPass());
+        }
+        else
+            modulePM.add(llvm::createAlwaysInlinerLegacyPass());
+        modulePM.add(llvm::createGlobalDCEPass());
+        modulePM.run(mod);
+    }
+} // namespace backend
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+namespace backend
+{
+    // The standard LLVM optimization pipeline, as used by clang for -O1..-O3 and -Os
+    class Optimizer
+    {
+    private:
+        unsigned int _OptLevel, _SizeLevel;
+        llvm::TargetMachine *_Machine;
+
+    public:
+        // `machine` provides the target cost model for the vectorizers, it may be nullptr
+        inline explicit Optimizer(unsigned int optLevel, unsigned int sizeLevel, llvm::TargetMachine *machine)
+            : _OptLevel(optLevel), _SizeLevel(sizeLevel), _Machine(machine) {}
+
+        inline bool IsEnabled() const { return _OptLevel > 0 || _SizeLevel > 0; }
+
+        // Fills in the passes of the pipeline without running them,
+        // use `-mllvm -debug-pass=Structure` to print them
+        void Populate(llvm::legacy::PassManager &modulePM, llvm::legacy::FunctionPassManager &functionPM) const;
+
+        // Runs the function pipeline on every function, then the module pipeline
+        void Run(llvm::Module &mod) const;
+
+        // Fills in a self-contained function pipeline, which optimizes each function
+        // on its own right after it is generated instead of running Run() at the end.
+        // Nothing is inlined across functions in this mode, until RunInterprocedural()
+        void PopulatePerFunction(llvm::legacy::FunctionPassManager &functionPM) const;
+
+        // Runs the cheap module passes that complete PopulatePerFunction() once the whole module
+        // is generated: global optimization and constant propagation, dead argument and global
+        // elimination and, from -O2 on, inlining. There is no vectorization or loop pipeline
+        void RunInterprocedural(llvm::Module &mod) const;
+    };
+} // namespace backend
@@ -0,0 +1,98 @@
+#include "Target.hpp"
+
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include <mutex>
+#include "../ErrorHandler.hpp"
+
+namespace backend
+{
+    void Target::InitializeNative()
+    {
+        static std::once_flag once;
+        std::call_once(once, [] {
+            llvm::InitializeNativeTarget();
+            llvm::InitializeNativeTargetAsmPrinter();
+            llvm::InitializeNativeTargetAsmParser();
+        });
+    }
+
+    std::unique_ptr<Target> Target::CreateHost()
+    {
+        InitializeNative();
+
+        auto triple = llvm::sys::getDefaultTargetTriple();
+        std::string error;
+        auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+        if (!target)
+        {
+            ErrorHandler::Stream() << "Error: " << error << '\n';
+            return nullptr;
+        }
+
+        // Generate code for the CPU we are running on
+        llvm::SubtargetFeatures features;
+        llvm::StringMap<bool> hostFeatures;
+        if (llvm::sys::getHostCPUFeatures(hostFeatures))
+            for (auto &f : hostFeatures)
+                features.AddFeature(f.first(), f.second);
+
+        llvm::TargetOptions options;
+        auto machine = target->createTargetMachine(triple, llvm::sys::getHostCPUName(), features.getString(),
+                                                   options, llvm::Reloc::PIC_);
+        if (!machine)
+        {
+            ErrorHandler::Stream() << "Error: Cannot create target machine for " << triple << '\n';
+            return nullptr;
+        }
+        return std::unique_ptr<Target>(new Target(std::unique_ptr<llvm::TargetMachine>(machine)));
+    }
+
+    void Target::Configure(llvm::Module &mod) const
+    {
+        mod.setTargetTriple(_Machine->getTargetTriple().str());
+        mod.setDataLayout(_Machine->createDataLayout());
+    }
+
+    bool Target::Emit(const llvm::Module &mod, const std::string &path, bool assembly)
+    {
+        std::error_code ec;
+        llvm::raw_fd_ostream output(path, ec, assembly ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None);
+        if (ec)
+        {
+            ErrorHandler::Stream() << "Error: Cannot open '" << path << "': " << ec.message() << '\n';
+            return false;
+        }
+        if (!Emit(mod, output, assembly))
+            return false;
+        // Reported here, the stream would abort on an unchecked error when it is destroyed
+        output.close();
+        if (output.has_error())
+        {
+            ErrorHandler::Stream() << "Error: Cannot write '" << path << "': " << output.error().message() << '\n';
+            output.clear_error();
+            return false;
+        }
+        return true;
+    }
+
+    bool Target::Emit(const llvm::Module &mod, llvm::raw_pwrite_stream &output, bool assembly)
+    {
+        llvm::legacy::PassManager pm;
+        auto type = assembly ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
+        if (_Machine->addPassesToEmitFile(pm, output, nullptr, type))
+        {
+            ErrorHandler::Stream() << "Error: The target cannot emit this kind of file\n";
+            return false;
+        }
+        pm.run(*llvm::CloneModule(mod));
+        return true;
+    }
+} // namespace backend
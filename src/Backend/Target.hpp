@@ -0,0 +1,39 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <memory>
+#include <string>
+
+namespace backend
+{
+    // Native code generation for the host machine
+    class Target
+    {
+    private:
+        std::unique_ptr<llvm::TargetMachine> _Machine;
+
+        inline explicit Target(std::unique_ptr<llvm::TargetMachine> machine) : _Machine(std::move(machine)) {}
+
+    public:
+        // Registers the native target with LLVM, only the first call does the work,
+        // so compile workers may call it concurrently
+        static void InitializeNative();
+
+        // Returns nullptr and prints the reason if the host is not supported
+        static std::unique_ptr<Target> CreateHost();
+
+        inline llvm::TargetMachine &GetMachine() { return *_Machine; }
+
+        // Attaches the target triple and data layout to the module,
+        // which should be done before any optimization
+        void Configure(llvm::Module &mod) const;
+
+        // Writes an object file, or an assembly file if `assembly` is set. The code generation
+        // passes change the IR, so they run on a copy and `mod` can still be emitted or run
+        bool Emit(const llvm::Module &mod, const std::string &path, bool assembly);
+        bool Emit(const llvm::Module &mod, llvm::raw_pwrite_stream &output, bool assembly);
+    };
+} // namespace backend
@@ -0,0 +1,307 @@
+#include "Cache.hpp"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <link.h>
+#include <sstream>
+#include <sys/file.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "ErrorHandler.hpp"
+
+// Marks the end of an entry, whose diagnostics are written last
+static const char *const DIAGNOSTICS_EXT = ".diag";
+// Estimate of the total size of the entries, so that storing does not scan the directory
+static const char *const SIZE_FILE = "size";
+
+// The GNU build ID of the executable, which the linker computes from its contents, empty if
+// it was linked without one
+static std::string ReadBuildID()
+{
+    std::string id;
+    dl_iterate_phdr(
+        [](dl_phdr_info *info, size_t, void *data) {
+            for (int i = 0; i < info->dlpi_phnum; ++i)
+            {
+                const auto &segment = info->dlpi_phdr[i];
+                if (segment.p_type != PT_NOTE)
+                    continue;
+                auto note = reinterpret_cast<const char *>(info->dlpi_addr + segment.p_vaddr);
+                auto end = note + segment.p_memsz;
+                while (note + sizeof(ElfW(Nhdr)) <= end)
+                {
+                    auto header = reinterpret_cast<const ElfW(Nhdr) *>(note);
+                    auto name = note + sizeof(ElfW(Nhdr));
+                    auto desc = name + ((header->n_namesz + 3) & ~3u);
+                    if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 && std::memcmp(name, "GNU", 4) == 0)
+                    {
+                        *static_cast<std::string *>(data) = llvm::toHex(llvm::StringRef(desc, header->n_descsz), true);
+                        break;
+                    }
+                    note = desc + ((header->n_descsz + 3) & ~3u);
+                }
+            }
+            // The first object is the executable
+            return 1;
+        },
+        &id);
+    return id;
+}
+
+// Identifies the code of the running compiler, whose outputs may differ from other builds
+static const std::string &CompilerBuild()
+{
+    static const std::string build = []() {
+        auto id = ReadBuildID();
+        if (id.empty())
+        {
+            // Without a build ID, hash the whole executable once
+            auto exe = llvm::MemoryBuffer::getFile("/proc/self/exe");
+            id = exe ? llvm::toHex(llvm::SHA1::hash(llvm::arrayRefFromStringRef((*exe)->getBuffer())), true)
+                     : "unknown";
+        }
+        return "LLVM " LLVM_VERSION_STRING ", build " + id;
+    }();
+    return build;
+}
+
+static bool ReadFile(const std::string &path, std::string &content)
+{
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+        return false;
+    std::ostringstream ss;
+    ss << input.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+std::string Cache::KindDir(Kind kind) const
+{
+    return _Dir + (kind == Kind::File ? "/files" : "/functions");
+}
+
+std::string Cache::EntryPath(Kind kind, const std::string &key, const std::string &ext) const
+{
+    return KindDir(kind) + '/' + key + ext;
+}
+
+bool Cache::Init() const
+{
+    for (auto kind : {Kind::File, Kind::Function})
+        if (auto ec = llvm::sys::fs::create_directories(KindDir(kind)))
+        {
+            ErrorHandler::Stream() << "Error: Cannot create cache directory '" << KindDir(kind)
+                                   << "': " << ec.message() << '\n';
+            return false;
+        }
+    return true;
+}
+
+std::string Cache::Key(std::string_view source, const Options &opts)
+{
+    // Every part ends with a zero byte, so that no two different lists give the same text
+    llvm::SHA1 hash;
+    auto add = [&hash](llvm::StringRef part) {
+        hash.update(part);
+        hash.update(llvm::StringRef("", 1));
+    };
+    add(CompilerBuild());
+    add(llvm::sys::getDefaultTargetTriple());
+    add(llvm::sys::getHostCPUName());
+    add(std::to_string(opts.OptLevel));
+    add(std::to_string(opts.SizeLevel));
+    add(opts.PerFunctionOpt ? "per-function" : "module");
+    add(opts.Incremental ? "incremental" : "whole");
+    for (const auto &arg : opts.LLVMArgs)
+        add(arg);
+    add(llvm::StringRef(source.data(), source.size()));
+    return llvm::toHex(hash.final(), true);
+}
+
+bool Cache::WriteAtomic(const std::string &path, const std::string &content) const
+{
+    int fd;
+    llvm::SmallString<128> tmpPath;
+    if (llvm::sys::fs::createUniqueFile(_Dir + "/tmp-%%%%%%%%%%%%", fd, tmpPath))
+        return false;
+    {
+        llvm::raw_fd_ostream output(fd, true);
+        output << content;
+        output.close();
+        if (output.has_error())
+        {
+            output.clear_error();
+            llvm::sys::fs::remove(tmpPath);
+            return false;
+        }
+    }
+    if (llvm::sys::fs::rename(tmpPath, path))
+    {
+        llvm::sys::fs::remove(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+bool Cache::Fetch(const std::string &key, const Outputs &outputs, std::string &diagnostics)
+{
+    std::vector<std::string> contents(outputs.size());
+    for (size_t i = 0; i < outputs.size(); ++i)
+        if (!ReadFile(EntryPath(Kind::File, key, outputs[i].first), contents[i]))
+        {
+            ++_Misses;
+            return false;
+        }
+    if (!ReadFile(EntryPath(Kind::File, key, DIAGNOSTICS_EXT), diagnostics))
+    {
+        ++_Misses;
+        return false;
+    }
+
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        std::ofstream output(outputs[i].second, std::ios::binary);
+        output.write(contents[i].data(), contents[i].size());
+        output.close();
+        // The compilation writes the outputs again, or reports why it cannot
+        if (!output)
+        {
+            ++_Misses;
+            return false;
+        }
+        // Touch the entry, eviction removes the least recently used ones first
+        utimes(EntryPath(Kind::File, key, outputs[i].first).c_str(), nullptr);
+    }
+    utimes(EntryPath(Kind::File, key, DIAGNOSTICS_EXT).c_str(), nullptr);
+    ++_Hits;
+    return true;
+}
+
+void Cache::Store(const std::string &key, const Outputs &outputs, const std::string &diagnostics)
+{
+    for (const auto &ext : outputs)
+    {
+        std::string content;
+        if (!ReadFile(ext.second, content) || !Save(Kind::File, key, ext.first, content))
+            return;
+    }
+    if (Save(Kind::File, key, DIAGNOSTICS_EXT, diagnostics))
+        EvictIfNeeded(Kind::File);
+}
+
+bool Cache::Load(Kind kind, const std::string &key, const std::string &ext, std::string &content) const
+{
+    auto path = EntryPath(kind, key, ext);
+    if (!ReadFile(path, content))
+        return false;
+    utimes(path.c_str(), nullptr);
+    return true;
+}
+
+bool Cache::Save(Kind kind, const std::string &key, const std::string &ext, const std::string &content)
+{
+    if (!WriteAtomic(EntryPath(kind, key, ext), content))
+        return false;
+    _SavedBytes[static_cast<size_t>(kind)] += content.size();
+    return true;
+}
+
+std::optional<uint64_t> Cache::UpdateSize(Kind kind, std::optional<uint64_t> total, uint64_t added) const
+{
+    // Locked, so that concurrent compilers do not lose each other's additions
+    int fd = open((KindDir(kind) + '/' + SIZE_FILE).c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return std::nullopt;
+    flock(fd, LOCK_EX);
+    if (!total)
+    {
+        char text[32] = {};
+        auto count = pread(fd, text, sizeof(text) - 1, 0);
+        char *end = nullptr;
+        auto previous = count > 0 ? std::strtoull(text, &end, 10) : 0;
+        // A missing or damaged estimate makes the caller scan the directory
+        if (count > 0 && end && *end == '\n')
+            total = previous + added;
+    }
+    if (total)
+    {
+        auto text = std::to_string(*total) + '\n';
+        if (pwrite(fd, text.data(), text.size(), 0) != static_cast<ssize_t>(text.size()) ||
+            ftruncate(fd, text.size()) != 0)
+            total = std::nullopt;
+    }
+    close(fd);
+    return total;
+}
+
+void Cache::EvictIfNeeded(Kind kind)
+{
+    auto total = UpdateSize(kind, std::nullopt, _SavedBytes[static_cast<size_t>(kind)].exchange(0));
+    // Overwritten entries are counted twice, which only makes the next scan come earlier
+    if (!total || *total > _MaxBytes)
+        Evict(kind);
+}
+
+void Cache::Evict(Kind kind)
+{
+    struct File
+    {
+        std::string Path;
+        uint64_t Size;
+        llvm::sys::TimePoint<> Time;
+    };
+    std::vector<File> files;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(KindDir(kind), ec), end; it != end && !ec; it.increment(ec))
+    {
+        // Files being written by other compilers are not entries yet
+        auto name = llvm::StringRef(it->path()).rsplit('/').second;
+        llvm::sys::fs::file_status status;
+        if (name.startswith("tmp-") || name == SIZE_FILE ||
+            llvm::sys::fs::status(it->path(), status) || status.type() != llvm::sys::fs::file_type::regular_file)
+            continue;
+        files.push_back(File{it->path(), status.getSize(), status.getLastModificationTime()});
+        total += status.getSize();
+    }
+    if (total <= _MaxBytes)
+    {
+        UpdateSize(kind, total, 0);
+        return;
+    }
+    std::sort(files.begin(), files.end(), [](const File &a, const File &b) { return a.Time < b.Time; });
+    for (const auto &f : files)
+    {
+        if (total <= _MaxBytes)
+            break;
+        // Another compiler may have removed it already
+        if (!llvm::sys::fs::remove(f.Path))
+            ++_Evictions;
+        total -= f.Size;
+    }
+    UpdateSize(kind, total, 0);
+}
+
+void Cache::PrintStats(std::ostream &out) const
+{
+    unsigned int hits = _Hits, misses = _Misses;
+    out << "Cache " << _Dir << ": " << hits << " hits, " << misses << " misses";
+    if (hits + misses > 0)
+        out << " (" << hits * 100 / (hits + misses) << "% hit rate)";
+    out << ", " << _Evictions << " files evicted";
+    if (_FunctionsReused + _FunctionsRegenerated > 0)
+        out << ", " << _FunctionsReused << " functions reused, " << _FunctionsRegenerated << " regenerated";
+    out << '\n';
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Options.hpp"
+
+// Content-addressed cache of compiler outputs on disk. An entry is keyed by a hash of the source,
+// the compiler build and every option that changes the outputs, and holds one file per output
+// kind plus the diagnostics. Entries are written atomically, so several compilers may share the
+// directory, and the least recently used ones are removed when it grows over its size limit
+class Cache
+{
+public:
+    // Output extension, such as ".bc", and the path the output is written to
+    using Outputs = std::vector<std::pair<std::string, std::string>>;
+
+    // Whole files and the single functions of incremental compilation live in subdirectories of
+    // their own, each with half of the size limit, so that one kind never evicts the other
+    enum class Kind
+    {
+        File,
+        Function
+    };
+
+private:
+    std::string _Dir;
+    // Limit of each kind
+    uint64_t _MaxBytes;
+    std::atomic<unsigned int> _Hits{0}, _Misses{0}, _Evictions{0};
+    std::atomic<unsigned int> _FunctionsReused{0}, _FunctionsRegenerated{0};
+    // Bytes saved since the size estimate of each kind was last updated
+    std::atomic<uint64_t> _SavedBytes[2]{};
+
+    std::string KindDir(Kind kind) const;
+    std::string EntryPath(Kind kind, const std::string &key, const std::string &ext) const;
+    // Writes `content` to a temporary file in the directory, then renames it to `path`
+    bool WriteAtomic(const std::string &path, const std::string &content) const;
+    // Replaces the estimate of the total size of a kind with `total`, or adds `added` to it if
+    // `total` is nullopt. Returns the new estimate, nullopt if it is missing or cannot be written
+    std::optional<uint64_t> UpdateSize(Kind kind, std::optional<uint64_t> total, uint64_t added) const;
+    // Removes the least recently used files of a kind until they fit into its size limit
+    void Evict(Kind kind);
+
+public:
+    inline explicit Cache(const std::string &dir, uint64_t maxBytes) : _Dir(dir), _MaxBytes(maxBytes / 2) {}
+
+    // Creates the directories, returns false after printing the reason
+    bool Init() const;
+
+    // The key of compiling `source` with `opts` on this host with this build of the compiler
+    static std::string Key(std::string_view source, const Options &opts);
+
+    // Copies every requested output of the entry to its path and returns the stored diagnostics.
+    // Returns false on a miss, when any of the outputs is not cached
+    bool Fetch(const std::string &key, const Outputs &outputs, std::string &diagnostics);
+
+    // Adds the outputs written by a successful compilation, then evicts old entries if needed
+    void Store(const std::string &key, const Outputs &outputs, const std::string &diagnostics);
+
+    // Single files of an entry, as used by incremental compilation for each function.
+    // Save() does not evict, call EvictIfNeeded() once after saving a batch of files
+    bool Load(Kind kind, const std::string &key, const std::string &ext, std::string &content) const;
+    bool Save(Kind kind, const std::string &key, const std::string &ext, const std::string &content);
+    // Adds the saved files to the size estimate kept in the directory of the kind, and only
+    // scans it with Evict() when the estimate is over the limit
+    void EvictIfNeeded(Kind kind);
+    inline void CountFunction(bool reused) { ++(reused ? _FunctionsReused : _FunctionsRegenerated); }
+    inline unsigned int GetFunctionsReused() const { return _FunctionsReused; }
+    inline unsigned int GetFunctionsRegenerated() const { return _FunctionsRegenerated; }
+
+    void PrintStats(std::ostream &out) const;
+};
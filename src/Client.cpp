@@ -0,0 +1,81 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "Options.hpp"
+#include "Server/Protocol.hpp"
+
+// Writes one output of the server next to the input, as build/exe would
+bool WriteOutput(const std::string &path, const std::string &content)
+{
+    std::ofstream output(path, std::ios::binary);
+    if (!output.write(content.data(), content.size()))
+    {
+        std::cerr << "Error: Cannot write '" << path << "'\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <socket> [options] <file>\n";
+        std::cerr << "  Compile the file with the server started by build/exe --serve <socket>,\n";
+        std::cerr << "  the options and outputs are the same as for build/exe\n";
+        return 1;
+    }
+    // Parse the options here as well, to know where the outputs go
+    Options opts;
+    if (!opts.Parse(argc - 1, argv + 1))
+        return 1;
+    if (opts.Inputs.size() != 1)
+    {
+        std::cerr << "Error: The client compiles exactly one input file\n";
+        return 1;
+    }
+    const auto &input = opts.Inputs.front();
+
+    server::Request request;
+    request.Args.assign(argv + 2, argv + argc);
+    std::ifstream source(input);
+    if (!source)
+    {
+        std::cerr << "Error: Cannot open '" << input << "'\n";
+        return 1;
+    }
+    std::ostringstream ss;
+    ss << source.rdbuf();
+    request.Source = ss.str();
+
+    sockaddr_un addr;
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (!server::MakeAddress(argv[1], addr) || fd < 0 ||
+        connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        std::cerr << "Error: Cannot connect to '" << argv[1] << "': " << std::strerror(errno) << '\n';
+        return 1;
+    }
+    server::Response response;
+    if (!request.Write(fd) || !response.Read(fd))
+    {
+        std::cerr << "Error: The server closed the connection\n";
+        return 1;
+    }
+    close(fd);
+
+    std::cerr << response.Diagnostics;
+    if (response.Status != 0)
+        return response.Status;
+    bool success = true;
+    if (opts.EmitLLVM)
+        success &= WriteOutput(opts.OutputPath(input, ".ir"), response.IR);
+    if (opts.EmitBC)
+        success &= WriteOutput(opts.OutputPath(input, ".bc"), response.Bitcode);
+    if (opts.EmitAsm)
+        success &= WriteOutput(opts.OutputPath(input, ".s"), response.Assembly);
+    if (opts.EmitObj)
+        success &= WriteOutput(opts.OutputPath(input, ".o"), response.Object);
+    return success ? 0 : 1;
+}
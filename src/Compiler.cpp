@@ -0,0 +1,196 @@
+#include "Compiler.hpp"
+
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <exception>
+#include <iomanip>
+#include <sstream>
+#include "Scanner/Scanner.ih"
+#include "Scanner/TokenTape.hpp"
+#include "Parser/Parser.ih"
+#include "Backend/Target.hpp"
+#include "Backend/Optimizer.hpp"
+#include "PhaseTimer.hpp"
+#include "MemoryReport.hpp"
+
+bool Compiler::BuildModule(ast::DeclarationList &program, llvm::Module &mod, const Options &opts,
+                           backend::Target *target)
+{
+    backend::Optimizer optimizer(opts.OptLevel, opts.SizeLevel, target ? &target->GetMachine() : nullptr);
+    std::unique_ptr<llvm::legacy::FunctionPassManager> functionPM;
+    if (opts.PerFunctionOpt && optimizer.IsEnabled())
+    {
+        functionPM = std::make_unique<llvm::legacy::FunctionPassManager>(&mod);
+        optimizer.PopulatePerFunction(*functionPM);
+        functionPM->doInitialization();
+    }
+    // With -per-function-opt, the function passes are part of the codegen phase
+    PhaseTimer::Scope codegen("codegen");
+    auto success = program.CodeGen(mod.getContext(), mod, functionPM.get());
+    if (functionPM)
+        functionPM->doFinalization();
+    codegen.Stop();
+    auto report = MemoryReport::GetCurrent();
+    if (report)
+        report->AddSymbols(program);
+    if (!success)
+        return false;
+    PhaseTimer::Scope verify("verify");
+    llvm::raw_os_ostream diagnostics(ErrorHandler::Stream());
+    auto invalid = llvm::verifyModule(mod, &diagnostics);
+    verify.Stop();
+    if (invalid)
+    {
+        diagnostics.flush();
+        ErrorHandler::Stream() << "Error: Generated LLVM IR is invalid\n";
+        return false;
+    }
+    if (report)
+        report->AddModule("codegen", mod);
+    // Incremental compilation caches every function as it is generated, and runs the
+    // interprocedural passes once the cached ones are linked in
+    if (functionPM && !opts.Incremental)
+    {
+        PhaseTimer::Scope optimize("optimize");
+        optimizer.RunInterprocedural(mod);
+        optimize.Stop();
+        if (report)
+            report->AddModule("optimize", mod);
+    }
+    else if (!functionPM && !opts.OptimizeLazily() && optimizer.IsEnabled())
+    {
+        PhaseTimer::Scope optimize("optimize");
+        optimizer.Run(mod);
+        optimize.Stop();
+        if (report)
+            report->AddModule("optimize", mod);
+    }
+    return true;
+}
+
+void Compiler::ShowTokens(const TokenTape &tokens, std::ostream &os)
+{
+    os << std::setw(10) << "Token";
+    os << std::setw(15) << "Matched";
+    os << std::setw(10) << "Row";
+    os << std::setw(10) << "ColStart";
+    os << std::setw(10) << "ColEnd";
+    os << "\n\n";
+    auto output = [&](const auto &n, const TokenTape::Token &t) {
+        os << std::setw(10) << n;
+        os << std::setw(15) << t.Matched;
+        os << std::setw(10) << t.Location.Row;
+        os << std::setw(10) << t.Location.ColStart;
+        os << std::setw(10) << t.Location.ColEnd;
+        os << '\n';
+    };
+
+    for (const auto &t : tokens.GetTokens())
+    {
+        if (t.Kind == 0)
+            break;
+        if (t.Kind < 256)
+            output("CHAR", t);
+        else
+            output(Parser::TOKEN_NAMES[t.Kind - 257], t);
+    }
+}
+
+// Runs the whole pipeline, diagnostics go to ErrorHandler::Stream()
+static bool CompileInto(std::string_view source, const Options &opts, Compiler::Result &result)
+{
+    PhaseTimer::Scope scan("scan");
+    TokenTape tokens(source);
+    scan.Stop();
+    if (opts.EmitTokens)
+    {
+        PhaseTimer::Scope phase("dump tokens");
+        std::ostringstream lexOutput;
+        Compiler::ShowTokens(tokens, lexOutput);
+        result.Tokens = lexOutput.str();
+    }
+    PhaseTimer::Scope parse("parse");
+    Parser p(tokens);
+    auto failed = p.parse();
+    parse.Stop();
+    if (failed)
+        return false;
+    auto astRoot = p.GetRoot();
+    if (opts.EmitAST)
+    {
+        PhaseTimer::Scope phase("dump AST");
+        std::ostringstream astOutput;
+        astRoot->Show(astOutput);
+        result.AST = astOutput.str();
+    }
+
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto mod = std::make_unique<llvm::Module>("Module", *context);
+    std::unique_ptr<backend::Target> target;
+    if (opts.NeedTarget())
+    {
+        target = backend::Target::CreateHost();
+        if (!target)
+            return false;
+        target->Configure(*mod);
+    }
+    if (!Compiler::BuildModule(*ast::cast<ast::DeclarationList>(astRoot), *mod, opts, target.get()))
+        return false;
+
+    if (opts.EmitLLVM)
+    {
+        PhaseTimer::Scope phase("emit IR");
+        llvm::raw_string_ostream irOutput(result.IR);
+        mod->print(irOutput, nullptr);
+    }
+    if (opts.EmitBC)
+    {
+        PhaseTimer::Scope phase("emit bitcode");
+        llvm::raw_string_ostream bcOutput(result.Bitcode);
+        llvm::WriteBitcodeToFile(*mod, bcOutput);
+    }
+    for (auto assembly : {true, false})
+    {
+        if (!(assembly ? opts.EmitAsm : opts.EmitObj))
+            continue;
+        PhaseTimer::Scope phase(assembly ? "emit assembly" : "emit object");
+        llvm::SmallString<0> buffer;
+        llvm::raw_svector_ostream output(buffer);
+        if (!target->Emit(*mod, output, assembly))
+            return false;
+        (assembly ? result.Assembly : result.Object).assign(buffer.begin(), buffer.end());
+    }
+    result.Context = std::move(context);
+    result.Module = std::move(mod);
+    return true;
+}
+
+Compiler::Result Compiler::Compile(std::string_view source, const Options &opts)
+{
+    Result result;
+    std::ostringstream diagnostics;
+    {
+        ErrorHandler::Redirect redirect(diagnostics);
+        try
+        {
+            result.Success = CompileInto(source, opts, result);
+        }
+        catch (const std::exception &)
+        {
+            // ast_assert() fails on malformed trees, which the parser may leave behind
+            ErrorHandler::Stream() << "Error: Internal compiler error\n";
+            result.Success = false;
+        }
+    }
+    if (!result.Success)
+    {
+        result.Module.reset();
+        result.Context.reset();
+    }
+    result.Diagnostics = diagnostics.str();
+    return result;
+}
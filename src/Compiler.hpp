@@ -0,0 +1,53 @@
+#pragma once
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "Options.hpp"
+
+namespace ast
+{
+    class DeclarationList;
+}
+
+namespace backend
+{
+    class Target;
+}
+
+class TokenTape;
+
+// Library interface of the compiler. Compile() keeps all of its state in the call,
+// so several threads may compile at the same time
+class Compiler
+{
+public:
+    struct Result
+    {
+        bool Success = false;
+        // Warnings and errors, one per line in the format of ErrorHandler
+        std::string Diagnostics;
+        // The optimized module, nullptr if the compilation failed
+        std::unique_ptr<llvm::LLVMContext> Context;
+        std::unique_ptr<llvm::Module> Module;
+        // Filled in for -emit-tokens, -emit-ast, -emit-llvm, -emit-bc, -S and -c respectively
+        std::string Tokens, AST, IR, Bitcode, Assembly, Object;
+    };
+
+    // Compiles `source` with the optimization and output options of `opts`.
+    // Nothing is written to files or to std::cerr, inputs and -o are ignored
+    static Result Compile(std::string_view source, const Options &opts);
+
+    // Generates, verifies and optimizes the module of a parsed program, as the driver does.
+    // `target` is needed when optimizing, and the module must already be configured for it.
+    // Returns false after writing the reason to ErrorHandler::Stream()
+    static bool BuildModule(ast::DeclarationList &program, llvm::Module &mod, const Options &opts,
+                            backend::Target *target);
+
+    // Writes the token table of -emit-tokens
+    static void ShowTokens(const TokenTape &tokens, std::ostream &os);
+};
@@ -14,11 +14,35 @@ public:
             : Row(row), ColStart(colStart), ColEnd(colEnd) {}
     };
 
+    // Diagnostics of the calling thread are written here, std::cerr by default
+    inline static std::ostream &Stream() { return *StreamSlot(); }
+
+    // Sends the diagnostics of the calling thread to `output` while it is alive,
+    // so that files compiled concurrently do not mix their messages
+    class Redirect
+    {
+    private:
+        std::ostream *_Previous;
+
+    public:
+        inline explicit Redirect(std::ostream &output) : _Previous(StreamSlot()) { StreamSlot() = &output; }
+        inline ~Redirect() { StreamSlot() = _Previous; }
+        Redirect(const Redirect &) = delete;
+        Redirect &operator=(const Redirect &) = delete;
+    };
+
     inline static void PrintError(const std::string &msg, const Location &loc, bool isWarning = false)
     {
-        std::cerr << loc.Row << ':' << loc.ColStart << '-' << loc.ColEnd << '\t';
-        std::cerr << (isWarning ? "Warning" : "Error") << ": " << msg << '\n';
+        Stream() << loc.Row << ':' << loc.ColStart << '-' << loc.ColEnd << '\t';
+        Stream() << (isWarning ? "Warning" : "Error") << ": " << msg << '\n';
     }
 
     inline static void PrintWarning(const std::string &msg, const Location &loc) { PrintError(msg, loc, true); }
+
+private:
+    inline static std::ostream *&StreamSlot()
+    {
+        thread_local std::ostream *stream = &std::cerr;
+        return stream;
+    }
 };
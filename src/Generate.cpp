@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Size and shape of a generated program
+struct Shape
+{
+    // Keep adding functions until the program has this many lines, 0 to use Functions
+    unsigned long Lines = 0;
+    unsigned long Functions = 100;
+    unsigned long Statements = 20;
+    unsigned long Globals = 10;
+    // Nesting depth of the last expression of every function
+    unsigned long Depth = 10;
+    // Nesting depth of the blocks in every function
+    unsigned long Scopes = 3;
+    uint32_t Seed = 1;
+};
+
+// Writes a valid program of the given shape, the same shape and seed always give the same program
+class Generator
+{
+private:
+    Shape _Shape;
+    std::ostream &_Out;
+    unsigned long _Lines = 0;
+    uint32_t _State;
+
+    inline unsigned long Random(unsigned long n)
+    {
+        _State = _State * 1103515245 + 12345;
+        return (_State >> 8) % n;
+    }
+
+    inline void Line(const std::string &indent, const std::string &text)
+    {
+        _Out << indent << text << '\n';
+        ++_Lines;
+    }
+
+    inline std::string Operand()
+    {
+        switch (Random(_Shape.Globals > 0 ? 5 : 4))
+        {
+        case 0:
+            return "a";
+        case 1:
+            return "b";
+        case 2:
+            return "x";
+        case 3:
+            return std::to_string(Random(1000));
+        default:
+            return 'g' + std::to_string(Random(_Shape.Globals));
+        }
+    }
+
+    // Left-nested, so that both the parser and the code generator recurse `depth` times
+    inline std::string Expression(unsigned long depth)
+    {
+        static const char *ops[] = {" + ", " - ", " * ", " & ", " | ", " ^ "};
+        std::string expr = Operand();
+        for (unsigned long i = 0; i < depth; ++i)
+            expr = '(' + expr + ops[Random(6)] + Operand() + ')';
+        return expr;
+    }
+
+    inline void Statement(const std::string &indent, unsigned long function)
+    {
+        switch (Random(function > 0 ? 6 : 5))
+        {
+        case 0:
+            Line(indent, "x = " + Expression(3) + ';');
+            break;
+        case 1:
+            Line(indent, "if (x > " + std::to_string(Random(100)) + ')');
+            Line(indent + "    ", "x = x - " + Operand() + ';');
+            Line(indent, "else");
+            Line(indent + "    ", "y = y + " + Operand() + ';');
+            break;
+        case 2:
+            Line(indent, "for (i = 0; i < 4; ++i)");
+            Line(indent + "    ", "y = y + x * i;");
+            break;
+        case 3:
+            Line(indent, "while (y > 100)");
+            Line(indent + "    ", "y = y / 2;");
+            break;
+        case 4:
+            if (_Shape.Globals > 0)
+            {
+                auto global = 'g' + std::to_string(Random(_Shape.Globals));
+                Line(indent, global + " = " + global + " + x;");
+            }
+            else
+                Line(indent, "x = x + y;");
+            break;
+        default:
+            // Only earlier functions are called, so every call is to a known function
+            Line(indent, "x = x + f" + std::to_string(Random(function)) + "(y, a);");
+            break;
+        }
+    }
+
+    inline void Function(unsigned long k)
+    {
+        Line("", "int f" + std::to_string(k) + "(int a, int b)");
+        Line("", "{");
+        Line("    ", "int x = a, y = b, i;");
+        for (unsigned long i = 0; i < _Shape.Statements; ++i)
+            Statement("    ", k);
+        // The indentation stops growing, or deep scopes would be mostly spaces
+        auto indent = [](unsigned long level) { return std::string(4 * std::min(level, 16ul) + 4, ' '); };
+        for (unsigned long i = 0; i < _Shape.Scopes; ++i)
+        {
+            Line(indent(i), "{");
+            auto outer = i == 0 ? std::string("x") : 's' + std::to_string(i - 1);
+            Line(indent(i + 1), "int s" + std::to_string(i) + " = " + outer + " + " + std::to_string(i) + ';');
+        }
+        if (_Shape.Scopes > 0)
+            Line(indent(_Shape.Scopes), "x = x + s" + std::to_string(_Shape.Scopes - 1) + ';');
+        for (unsigned long i = _Shape.Scopes; i > 0; --i)
+            Line(indent(i - 1), "}");
+        Line("    ", "x = " + Expression(_Shape.Depth) + ';');
+        Line("    ", "return x + y;");
+        Line("", "}");
+        Line("", "");
+    }
+
+public:
+    inline explicit Generator(const Shape &shape, std::ostream &out) : _Shape(shape), _Out(out), _State(shape.Seed) {}
+
+    inline void Run()
+    {
+        Line("", "int putchar(int ch);");
+        Line("", "");
+        for (unsigned long i = 0; i < _Shape.Globals; ++i)
+            Line("", "int g" + std::to_string(i) + " = " + std::to_string(i) + ';');
+        Line("", "");
+        // main() calls f0, so there is always at least one function
+        for (unsigned long k = 0; k == 0 || (_Shape.Lines > 0 ? _Lines < _Shape.Lines : k < _Shape.Functions); ++k)
+            Function(k);
+        Line("", "void main(void)");
+        Line("", "{");
+        Line("    ", "putchar(48 + (f0(1, 2) & 7));");
+        Line("    ", "putchar(10);");
+        Line("", "}");
+    }
+};
+
+void ShowHelp(const char *name)
+{
+    std::cerr << "Usage: " << name << " [options]\n";
+    std::cerr << "  Write a valid program of the requested size and shape to stdout\n";
+    std::cerr << "Options: \n";
+    std::cerr << "  -lines <n>       add functions until the program has <n> lines\n";
+    std::cerr << "  -functions <n>   number of functions unless -lines is given, default 100\n";
+    std::cerr << "  -statements <n>  statements in every function, default 20\n";
+    std::cerr << "  -globals <n>     global variables used by the functions, default 10\n";
+    std::cerr << "  -depth <n>       nesting depth of one expression in every function, default 10\n";
+    std::cerr << "  -scopes <n>      nesting depth of the blocks in every function, default 3\n";
+    std::cerr << "  -seed <n>        seed of the random choices, default 1\n";
+}
+
+int main(int argc, const char *argv[])
+{
+    Shape shape;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        unsigned long *value = nullptr;
+        if (arg == "-lines")
+            value = &shape.Lines;
+        else if (arg == "-functions")
+            value = &shape.Functions;
+        else if (arg == "-statements")
+            value = &shape.Statements;
+        else if (arg == "-globals")
+            value = &shape.Globals;
+        else if (arg == "-depth")
+            value = &shape.Depth;
+        else if (arg == "-scopes")
+            value = &shape.Scopes;
+        else if (arg == "-seed" && i + 1 < argc)
+        {
+            shape.Seed = std::strtoul(argv[++i], nullptr, 10);
+            continue;
+        }
+        else
+        {
+            ShowHelp(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+        if (++i == argc)
+        {
+            std::cerr << "Error: Missing number after '" << arg << "'\n";
+            return 1;
+        }
+        *value = std::strtoul(argv[i], nullptr, 10);
+    }
+    std::ios::sync_with_stdio(false);
+    Generator(shape, std::cout).Run();
+    return 0;
+}
@@ -0,0 +1,307 @@
+#include "Incremental.hpp"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+#include "Compiler.hpp"
+#include "PhaseTimer.hpp"
+#include "MemoryReport.hpp"
+#include "Backend/Target.hpp"
+#include "Backend/Optimizer.hpp"
+#include "Parser/Parser.ih"
+
+namespace
+{
+    // A top-level declaration, which spans the tokens [Begin, End)
+    struct Entry
+    {
+        size_t Begin, End;
+        unsigned int FirstRow, LastRow;
+        ast::FuncDeclaration *Func = nullptr;
+        // Empty if the function is not cached, e.g. when it shares a line with another declaration
+        std::string Key;
+        bool Reused = false;
+        std::string Bitcode;
+        // Rows relative to FirstRow for reused functions, absolute otherwise
+        std::vector<std::string> Diagnostics;
+    };
+} // namespace
+
+// Splits the tokens after every top-level ';' and function body
+static std::vector<Entry> SplitDeclarations(const std::vector<TokenTape::Token> &tokens)
+{
+    std::vector<Entry> entries;
+    size_t begin = 0;
+    int depth = 0;
+    for (size_t i = 0; i < tokens.size() && tokens[i].Kind != 0; ++i)
+    {
+        auto kind = tokens[i].Kind;
+        if (kind == '{')
+            ++depth;
+        else if (kind == '}')
+            --depth;
+        if (depth == 0 && (kind == ';' || kind == '}'))
+        {
+            entries.push_back(Entry{begin, i + 1, tokens[begin].Location.Row, tokens[i].Location.Row});
+            begin = i + 1;
+        }
+    }
+    return entries;
+}
+
+// Tokens with their positions relative to the first row. Moving a declaration keeps
+// its text, reformatting it does not, because the warnings refer to its columns
+static std::string TokenText(const std::vector<TokenTape::Token> &tokens, size_t begin, size_t end,
+                             unsigned int firstRow)
+{
+    std::ostringstream ss;
+    for (auto i = begin; i < end; ++i)
+    {
+        const auto &t = tokens[i];
+        ss << t.Kind << ' ' << t.Location.Row - firstRow << ' ' << t.Location.ColStart << ' ' << t.Matched << '\0';
+    }
+    return ss.str();
+}
+
+// The row of a diagnostic "row:colStart-colEnd\tmessage", or 0 if it has none
+static unsigned int DiagnosticRow(const std::string &line)
+{
+    auto colon = line.find(':');
+    if (colon == 0 || colon == std::string::npos || line.find_first_not_of("0123456789") != colon)
+        return 0;
+    return std::stoul(line.substr(0, colon));
+}
+
+static std::string MoveDiagnostic(const std::string &line, long long offset)
+{
+    auto row = DiagnosticRow(line);
+    return std::to_string(row + offset) + line.substr(line.find(':'));
+}
+
+// Copies the function into a module of its own, which declares the globals it uses.
+// Returns nullptr if it uses other local values, whose definitions would have to be copied
+static std::unique_ptr<llvm::Module> ExtractFunction(llvm::Function &f)
+{
+    auto fnMod = std::make_unique<llvm::Module>(f.getName(), f.getContext());
+    fnMod->setTargetTriple(f.getParent()->getTargetTriple());
+    fnMod->setDataLayout(f.getParent()->getDataLayout());
+
+    llvm::ValueToValueMapTy vmap;
+    std::vector<const llvm::Value *> worklist;
+    std::set<const llvm::Value *> visited;
+    for (const auto &inst : llvm::instructions(f))
+        for (const auto &op : inst.operands())
+            worklist.push_back(op.get());
+    while (!worklist.empty())
+    {
+        auto value = worklist.back();
+        worklist.pop_back();
+        if (!visited.insert(value).second || value == &f)
+            continue;
+        if (auto gv = llvm::dyn_cast<llvm::GlobalValue>(value))
+        {
+            if (gv->hasLocalLinkage())
+                return nullptr;
+            if (auto g = llvm::dyn_cast<llvm::Function>(gv))
+            {
+                auto decl = llvm::Function::Create(g->getFunctionType(), llvm::Function::ExternalLinkage,
+                                                   g->getName(), *fnMod);
+                decl->copyAttributesFrom(g);
+                vmap[g] = decl;
+            }
+            else if (auto g = llvm::dyn_cast<llvm::GlobalVariable>(gv))
+                vmap[g] = new llvm::GlobalVariable(*fnMod, g->getValueType(), g->isConstant(),
+                                                   llvm::GlobalValue::ExternalLinkage, nullptr, g->getName());
+            else
+                return nullptr;
+        }
+        else if (auto c = llvm::dyn_cast<llvm::Constant>(value))
+            for (const auto &op : c->operands())
+                worklist.push_back(op.get());
+    }
+
+    auto copy = llvm::Function::Create(f.getFunctionType(), f.getLinkage(), f.getName(), *fnMod);
+    // Recursive calls
+    vmap[&f] = copy;
+    auto arg = copy->arg_begin();
+    for (const auto &a : f.args())
+    {
+        arg->setName(a.getName());
+        vmap[&a] = &*arg++;
+    }
+    llvm::SmallVector<llvm::ReturnInst *, 4> returns;
+    llvm::CloneFunctionInto(copy, &f, vmap, true, returns);
+    // Newer LLVM adds an empty list of compile units, which the bitcode reader warns about
+    if (auto units = fnMod->getNamedMetadata("llvm.dbg.cu"))
+        if (units->getNumOperands() == 0)
+            fnMod->eraseNamedMetadata(units);
+    return fnMod;
+}
+
+bool Incremental::BuildModule(const TokenTape &tokens, ast::DeclarationList &program, llvm::Module &mod,
+                              const Options &opts, backend::Target *target, Cache &cache)
+{
+    const auto &toks = tokens.GetTokens();
+    auto entries = SplitDeclarations(toks);
+    const auto &decls = program.GetDecls();
+    // The parser recovered from an error, so tokens and declarations do not match
+    if (entries.size() != decls.size())
+        return Compiler::BuildModule(program, mod, opts, target);
+
+    PhaseTimer::Scope lookup("cache lookup");
+    // Text of each visible name: the signature of a function or the whole global declaration
+    std::map<std::string, std::string> visible;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        auto &e = entries[i];
+        auto text = TokenText(toks, e.Begin, e.End, e.FirstRow);
+        e.Func = dynamic_cast<ast::FuncDeclaration *>(decls[i].get());
+        bool sharesRow = (i > 0 && entries[i - 1].LastRow == e.FirstRow) ||
+                         (i + 1 < entries.size() && entries[i + 1].FirstRow == e.LastRow);
+        if (e.Func && !sharesRow)
+        {
+            auto keyText = std::string("function") + '\0' + text;
+            std::set<std::string> names;
+            for (auto j = e.Begin; j < e.End; ++j)
+                if (toks[j].Kind == Parser::ID_TEXT)
+                    names.emplace(toks[j].Matched);
+            for (const auto &name : names)
+            {
+                auto iter = visible.find(name);
+                keyText += name + (iter == visible.end() ? std::string("?") : '=' + iter->second) + '\0';
+            }
+            e.Key = Cache::Key(keyText, opts);
+            std::string diagnostics;
+            if (cache.Load(Cache::Kind::Function, e.Key, ".bc", e.Bitcode) &&
+                cache.Load(Cache::Kind::Function, e.Key, ".diag", diagnostics))
+            {
+                e.Reused = true;
+                e.Func->SkipBody();
+                std::istringstream lines(diagnostics);
+                for (std::string line; std::getline(lines, line);)
+                    e.Diagnostics.push_back(MoveDiagnostic(line, e.FirstRow));
+            }
+            cache.CountFunction(e.Reused);
+        }
+
+        // Only the signature of a function is visible to the following ones
+        auto signatureEnd = e.Begin;
+        while (signatureEnd < e.End && (!e.Func || toks[signatureEnd].Kind != '{'))
+            ++signatureEnd;
+        for (const auto &name : decls[i]->GetNames())
+            visible[name] = TokenText(toks, e.Begin, signatureEnd, e.FirstRow);
+    }
+
+    lookup.Stop();
+
+    std::ostringstream captured;
+    bool success;
+    {
+        ErrorHandler::Redirect redirect(captured);
+        success = Compiler::BuildModule(program, mod, opts, target);
+    }
+    // Print the new and the cached diagnostics in the order of the declarations
+    std::vector<std::string> unattributed;
+    std::istringstream lines(captured.str());
+    for (std::string line; std::getline(lines, line);)
+    {
+        auto row = DiagnosticRow(line);
+        auto e = std::find_if(entries.begin(), entries.end(), [row](const Entry &e) {
+            return e.FirstRow <= row && row <= e.LastRow;
+        });
+        if (e == entries.end())
+            unattributed.push_back(line);
+        else
+            e->Diagnostics.push_back(line);
+    }
+    for (const auto &e : entries)
+        for (const auto &line : e.Diagnostics)
+            ErrorHandler::Stream() << line << '\n';
+    for (const auto &line : unattributed)
+        ErrorHandler::Stream() << line << '\n';
+    if (!success)
+        return false;
+
+    // The globals are private to the module, and a function that uses them could not be
+    // compiled on its own. They are shared by name until the cached functions are linked in
+    std::vector<llvm::GlobalVariable *> globals;
+    for (auto &g : mod.globals())
+        if (g.hasPrivateLinkage())
+        {
+            g.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            g.setVisibility(llvm::GlobalValue::HiddenVisibility);
+            globals.push_back(&g);
+        }
+
+    PhaseTimer::Scope store("cache store");
+    for (auto &e : entries)
+    {
+        if (e.Key.empty() || e.Reused)
+            continue;
+        auto fnMod = ExtractFunction(*mod.getFunction(e.Func->GetSymbolName()));
+        if (!fnMod)
+            continue;
+        std::string bitcode, diagnostics;
+        llvm::raw_string_ostream bcOutput(bitcode);
+        llvm::WriteBitcodeToFile(*fnMod, bcOutput);
+        bcOutput.flush();
+        for (const auto &line : e.Diagnostics)
+            diagnostics += MoveDiagnostic(line, -static_cast<long long>(e.FirstRow)) + '\n';
+        // The diagnostics complete the entry, so they are written last
+        if (cache.Save(Cache::Kind::Function, e.Key, ".bc", bitcode))
+            cache.Save(Cache::Kind::Function, e.Key, ".diag", diagnostics);
+    }
+    cache.EvictIfNeeded(Cache::Kind::Function);
+    store.Stop();
+
+    PhaseTimer::Scope link("link cached");
+    // One linker for all functions, creating it scans the whole module
+    llvm::Linker linker(mod);
+    for (auto &e : entries)
+    {
+        if (!e.Reused)
+            continue;
+        auto buffer = llvm::MemoryBuffer::getMemBuffer(e.Bitcode, e.Key, false);
+        auto fnMod = llvm::parseBitcodeFile(*buffer, mod.getContext());
+        if (!fnMod)
+        {
+            llvm::consumeError(fnMod.takeError());
+            ErrorHandler::Stream() << "Error: Cached code of '" << e.Func->GetSymbolName() << "' is invalid\n";
+            return false;
+        }
+        if (linker.linkInModule(std::move(*fnMod)))
+        {
+            ErrorHandler::Stream() << "Error: Cannot link the cached code of '" << e.Func->GetSymbolName() << "'\n";
+            return false;
+        }
+    }
+    // Private again, so that the optimizer sees every use of them
+    for (auto g : globals)
+    {
+        g->setVisibility(llvm::GlobalValue::DefaultVisibility);
+        g->setLinkage(llvm::GlobalValue::PrivateLinkage);
+    }
+    link.Stop();
+    auto report = MemoryReport::GetCurrent();
+    if (report)
+        report->AddModule("link cached", mod);
+
+    // Across the new and the cached functions, which is why it is not part of Compiler::BuildModule
+    PhaseTimer::Scope optimize("optimize");
+    backend::Optimizer(opts.OptLevel, opts.SizeLevel, target ? &target->GetMachine() : nullptr).RunInterprocedural(mod);
+    optimize.Stop();
+    if (report)
+        report->AddModule("optimize", mod);
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include "Options.hpp"
+#include "Cache.hpp"
+#include "Scanner/TokenTape.hpp"
+
+namespace ast
+{
+    class DeclarationList;
+}
+
+namespace backend
+{
+    class Target;
+}
+
+// Function-granular recompilation. Every function is keyed by its tokens and by the
+// declarations it may refer to, i.e. the signatures of the functions and the globals
+// declared before it whose names it uses. Functions whose key is in the cache only get
+// a prototype, and their optimized bitcode and warnings are taken from the cache
+class Incremental
+{
+public:
+    // Same as Compiler::BuildModule(), with per-function optimization
+    static bool BuildModule(const TokenTape &tokens, ast::DeclarationList &program, llvm::Module &mod,
+                            const Options &opts, backend::Target *target, Cache &cache);
+};
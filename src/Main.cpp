@@ -2,89 +2,449 @@
 #include <iomanip>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <cerrno>
+#include <cstring>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/TimeProfiler.h>
 #include "Scanner/Scanner.ih"
+#include "Scanner/TokenTape.hpp"
+#include "Scanner/SourceBuffer.hpp"
 #include "Parser/Parser.ih"
 #include "SymbolTable.hpp"
+#include "Options.hpp"
+#include "Compiler.hpp"
+#include "PhaseTimer.hpp"
+#include "MemoryReport.hpp"
+#include "Cache.hpp"
+#include "Incremental.hpp"
+#include "Backend/Target.hpp"
+#include "Backend/Optimizer.hpp"
+#include "Backend/JIT.hpp"
+#include "Server/Server.hpp"
+#include "Server/ForkServer.hpp"
 
-void TestScanner(std::ifstream& input, std::ofstream& lexOutput)
+// Writes an LLVM output file through `write`, returns false after printing why it cannot
+template <typename Write>
+bool WriteOutput(const std::string& path, Write write)
 {
-    Scanner s(input, std::cerr);
-
-    lexOutput << std::setw(10) << "Token";
-    lexOutput << std::setw(15) << "Matched";
-    lexOutput << std::setw(10) << "Row";
-    lexOutput << std::setw(10) << "ColStart";
-    lexOutput << std::setw(10) << "ColEnd";
-    lexOutput << "\n\n";
-    auto output = [&](const auto &n) {
-        lexOutput << std::setw(10) << n;
-        lexOutput << std::setw(15) << s.matched();
-        lexOutput << std::setw(10) << s.GetLocation().Row;
-        lexOutput << std::setw(10) << s.GetLocation().ColStart;
-        lexOutput << std::setw(10) << s.GetLocation().ColEnd;
-        lexOutput << '\n';
-    };
+    std::error_code ec;
+    llvm::raw_fd_ostream output(path, ec);
+    if (ec)
+    {
+        ErrorHandler::Stream() << "Error: Cannot open '" << path << "': " << ec.message() << '\n';
+        return false;
+    }
+    write(output);
+    output.close();
+    if (output.has_error())
+    {
+        ErrorHandler::Stream() << "Error: Cannot write '" << path << "': " << output.error().message() << '\n';
+        output.clear_error();
+        return false;
+    }
+    return true;
+}
 
-    while (true)
+// Same as WriteOutput() for the dumps, which are written to a std::ostream
+template <typename Write>
+bool WriteDump(const std::string& path, Write write)
+{
+    std::ofstream output(path);
+    if (!output)
     {
-        auto tok = s.lex();
-        if (tok == 0)
-            break;
-        if (tok < 256)
-            output("CHAR");
-        else
-            output(Parser::TOKEN_NAMES[tok - 257]);
+        ErrorHandler::Stream() << "Error: Cannot open '" << path << "': " << std::strerror(errno) << '\n';
+        return false;
+    }
+    write(output);
+    output.close();
+    if (!output)
+    {
+        ErrorHandler::Stream() << "Error: Cannot write '" << path << "'\n";
+        return false;
     }
+    return true;
 }
 
-void TestLLVM(std::ifstream& input, std::ofstream& astOutput, llvm::raw_fd_ostream& irOutput)
+// Returns the exit status of the driver, which is the result of the program for --run
+int TestLLVM(TokenTape& tokens, const std::string& input, const Options& opts, Cache* cache)
 {
-    Scanner s(input, std::cerr);
-    Parser p(s);
-    if (p.parse())
-        return;
+    // Declared before the parser, so that it outlives the AST
+    MemoryReport::TrackNodes nodes;
+    PhaseTimer::Scope parse("parse");
+    Parser p(tokens);
+    auto failed = p.parse();
+    parse.Stop();
+    if (failed)
+        return 1;
     auto astRoot = p.GetRoot();
-    astRoot->Show(astOutput);
-    llvm::LLVMContext context;
-    llvm::Module mod("Module", context);
-    auto success = ast::cast<ast::DeclarationList>(astRoot)->CodeGen(context, mod);
-    if (success)
-        mod.print(irOutput, nullptr);
+    if (auto report = MemoryReport::GetCurrent())
+        report->AddNodes(nodes);
+    if (opts.EmitAST)
+    {
+        PhaseTimer::Scope phase("dump AST");
+        if (!WriteDump(opts.OutputPath(input, ".ast"), [&](std::ostream& os) { astRoot->Show(os); }))
+            return 1;
+    }
+    if (!opts.NeedModule())
+        return 0;
+    // Owned by pointers, so that --run can hand them over to the JIT
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto mod = std::make_unique<llvm::Module>("Module", *context);
+    std::unique_ptr<backend::Target> target;
+    if (opts.NeedTarget())
+    {
+        target = backend::Target::CreateHost();
+        if (!target)
+            return 1;
+        target->Configure(*mod);
+    }
+    auto &program = *ast::cast<ast::DeclarationList>(astRoot);
+    auto built = opts.Incremental ? Incremental::BuildModule(tokens, program, *mod, opts, target.get(), *cache)
+                                  : Compiler::BuildModule(program, *mod, opts, target.get());
+    if (!built)
+        return 1;
+    if (opts.EmitLLVM)
+    {
+        PhaseTimer::Scope phase("emit IR");
+        if (!WriteOutput(opts.OutputPath(input, ".ir"), [&](llvm::raw_ostream& os) { mod->print(os, nullptr); }))
+            return 1;
+    }
+    if (opts.EmitBC)
+    {
+        // Write bitcode in-process instead of printing text IR for llvm-as
+        PhaseTimer::Scope phase("emit bitcode");
+        auto writeBitcode = [&](llvm::raw_ostream& os) { llvm::WriteBitcodeToFile(*mod, os); };
+        if (!WriteOutput(opts.OutputPath(input, ".bc"), writeBitcode))
+            return 1;
+    }
+    if (opts.EmitAsm)
+    {
+        PhaseTimer::Scope phase("emit assembly");
+        if (!target->Emit(*mod, opts.OutputPath(input, ".s"), true))
+            return 1;
+    }
+    if (opts.EmitObj)
+    {
+        PhaseTimer::Scope phase("emit object");
+        if (!target->Emit(*mod, opts.OutputPath(input, ".o"), false))
+            return 1;
+    }
+    if (opts.Run)
+    {
+        // Includes the lazy compilation of the functions that are called
+        PhaseTimer::Scope phase("run");
+        std::optional<int> result;
+        if (opts.Lazy)
+        {
+            backend::Optimizer lazyOptimizer(opts.OptimizeLazily() ? opts.OptLevel : 0,
+                                             opts.OptimizeLazily() ? opts.SizeLevel : 0,
+                                             target ? &target->GetMachine() : nullptr);
+            result = backend::JIT::RunLazy(std::move(context), std::move(mod), lazyOptimizer, opts.SpeculateThreads);
+        }
+        else
+            result = backend::JIT::Run(std::move(context), std::move(mod));
+        return result ? *result : 1;
+    }
+    return 0;
+}
+
+// Compiles the text of the input file and returns its exit status
+int CompileFile(std::string_view source, const std::string& path, const Options& opts, Cache* cache)
+{
+    // Scan the input only once, all outputs share the same tokens
+    PhaseTimer::Scope scan("scan");
+    TokenTape tokens(source);
+    scan.Stop();
+
+    if (opts.EmitTokens)
+    {
+        PhaseTimer::Scope phase("dump tokens");
+        if (!WriteDump(opts.OutputPath(path, ".lex"), [&](std::ostream& os) { Compiler::ShowTokens(tokens, os); }))
+            return 1;
+    }
+
+    // Do not parse if nobody needs the AST
+    if (!opts.EmitAST && !opts.NeedModule())
+        return 0;
+    return TestLLVM(tokens, path, opts, cache);
+}
+
+// The outputs of TestLLVM() that can be cached, by extension
+Cache::Outputs CachedOutputs(const std::string& path, const Options& opts)
+{
+    Cache::Outputs outputs;
+    for (auto [emit, ext] : {std::pair(opts.EmitLLVM, ".ir"), std::pair(opts.EmitBC, ".bc"),
+                             std::pair(opts.EmitAsm, ".s"), std::pair(opts.EmitObj, ".o")})
+        if (emit)
+            outputs.emplace_back(ext, opts.OutputPath(path, ext));
+    return outputs;
+}
+
+// Compiles one input file and returns its exit status
+int CompileFile(const std::string& path, const Options& opts, Cache* cache)
+{
+    // Outlives the tokens and the AST, which point into it
+    SourceBuffer source;
+    if (!source.Open(path))
+        return 1;
+    // Tokens, the AST and programs that run are not cached
+    if (!cache || opts.EmitTokens || opts.EmitAST || opts.Run)
+        return CompileFile(source.GetText(), path, opts, cache);
+
+    // A hit skips scanning, parsing and code generation
+    auto key = Cache::Key(source.GetText(), opts);
+    auto outputs = CachedOutputs(path, opts);
+    std::string text;
+    PhaseTimer::Scope lookup("cache lookup");
+    auto hit = cache->Fetch(key, outputs, text);
+    lookup.Stop();
+    if (hit)
+    {
+        ErrorHandler::Stream() << text;
+        return 0;
+    }
+    std::ostringstream diagnostics;
+    int status;
+    {
+        ErrorHandler::Redirect redirect(diagnostics);
+        status = CompileFile(source.GetText(), path, opts, cache);
+    }
+    ErrorHandler::Stream() << diagnostics.str();
+    if (status == 0)
+    {
+        PhaseTimer::Scope phase("cache store");
+        cache->Store(key, outputs, diagnostics.str());
+    }
+    return status;
+}
+
+// CompileFile() that fails only this input on an exception, which would
+// otherwise terminate the other workers of a batch as well
+int CompileInput(const std::string& path, const Options& opts, Cache* cache)
+{
+    try
+    {
+        return CompileFile(path, opts, cache);
+    }
+    catch (const std::exception &)
+    {
+        // ast_assert() fails on malformed trees, which the parser may leave behind
+        ErrorHandler::Stream() << "Error: Internal compiler error\n";
+        return 1;
+    }
+}
+
+// Compiles one input file like CompileFile() and writes a Chrome trace of it to <file>.json,
+// or to the path of -o
+int TraceFile(const std::string& path, const Options& opts, Cache* cache)
+{
+    llvm::timeTraceProfilerInitialize(opts.TimeTraceGranularity, "exe");
+    int status;
+    {
+        llvm::TimeTraceScope trace("Compile", path);
+        status = CompileInput(path, opts, cache);
+    }
+    auto tracePath = opts.OutputPath(path, ".json");
+    std::error_code ec;
+    llvm::raw_fd_ostream traceOutput(tracePath, ec);
+    if (ec)
+    {
+        ErrorHandler::Stream() << "Error: Cannot write '" << tracePath << "': " << ec.message() << '\n';
+        status = 1;
+    }
+    else
+        llvm::timeTraceProfilerWrite(traceOutput);
+    llvm::timeTraceProfilerCleanup();
+    return status;
+}
+
+// Compiles every input on opts.Jobs threads. Each file gets its own LLVMContext,
+// Scanner and Parser, and its diagnostics are printed together once it is done
+int CompileBatch(const Options& opts, Cache* cache)
+{
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex printMutex;
+    auto timer = PhaseTimer::GetCurrent();
+    auto report = MemoryReport::GetCurrent();
+    auto worker = [&]() {
+        PhaseTimer::Install install(timer);
+        MemoryReport::Install installReport(report);
+        size_t i;
+        while ((i = next++) < opts.Inputs.size())
+        {
+            const auto &path = opts.Inputs[i];
+            std::ostringstream diagnostics;
+            int status;
+            {
+                ErrorHandler::Redirect redirect(diagnostics);
+                status = opts.TimeTrace ? TraceFile(path, opts, cache) : CompileInput(path, opts, cache);
+            }
+            if (status != 0)
+                failed = true;
+            auto text = diagnostics.str();
+            if (!text.empty())
+            {
+                std::lock_guard<std::mutex> lock(printMutex);
+                std::cerr << "In " << path << ":\n" << text;
+            }
+        }
+    };
+
+    auto jobs = std::min<size_t>(opts.Jobs, opts.Inputs.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < jobs; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for (auto &w : workers)
+        w.join();
+    return failed ? 1 : 0;
+}
+
+// Compiles the input files of the parsed options
+int CompileInputs(const Options& opts)
+{
+    std::unique_ptr<PhaseTimer> timer;
+    if (opts.TimePhases || !opts.TimePhasesJSON.empty() || opts.MemReport || opts.HardwareCounters)
+        timer = std::make_unique<PhaseTimer>(opts.HardwareCounters);
+    PhaseTimer::Install install(timer.get());
+    std::unique_ptr<MemoryReport> report;
+    if (opts.MemReport)
+        report = std::make_unique<MemoryReport>();
+    MemoryReport::Install installReport(report.get());
+    std::unique_ptr<Cache> cache;
+    if (!opts.CacheDir.empty())
+    {
+        cache = std::make_unique<Cache>(opts.CacheDir, opts.CacheSizeMB << 20);
+        if (!cache->Init())
+            return 1;
+    }
+    int status;
+    if (opts.Inputs.size() > 1)
+        status = CompileBatch(opts, cache.get());
+    else if (opts.TimeTrace)
+        status = TraceFile(opts.Inputs.front(), opts, cache.get());
+    else
+        status = CompileInput(opts.Inputs.front(), opts, cache.get());
+    if (opts.CacheStats)
+        cache->PrintStats(std::cerr);
+    if (opts.TimePhases)
+        timer->PrintTable(std::cerr);
+    if (opts.HardwareCounters)
+        timer->PrintCounterTable(std::cerr);
+    if (opts.MemReport)
+    {
+        timer->PrintMemoryTable(std::cerr);
+        report->Print(std::cerr);
+    }
+    if (!opts.TimePhasesJSON.empty())
+    {
+        std::ofstream json(opts.TimePhasesJSON);
+        if (!json)
+        {
+            std::cerr << "Error: Cannot write '" << opts.TimePhasesJSON << "'\n";
+            return 1;
+        }
+        timer->PrintJSON(json);
+    }
+    return status;
 }
 
 void ShowHelp(const char *name)
 {
-    std::cerr << "Usage: " << name << " <file>\n";
-    std::cerr << "  Compile the specified file\n";
-    std::cerr << "Output: \n";
-    std::cerr << "  <file>.lex  contains the result of scanner\n";
-    std::cerr << "  <file>.ast  contains the Abstract Syntax Tree(AST)\n";
-    std::cerr << "  <file>.ir   contains the generated LLVM IR code\n";
+    std::cerr << "Usage: " << name << " [options] <file>...\n";
+    std::cerr << "       " << name << " [-j <n>] [-mllvm <opt>]... --serve <socket>\n";
+    std::cerr << "       " << name << " [-mllvm <opt>]... --fork-server\n";
+    std::cerr << "  Compile the specified files, several files are compiled concurrently\n";
+    std::cerr << "Options: \n";
+    std::cerr << "  -emit-tokens  write <file>.lex, which contains the result of scanner\n";
+    std::cerr << "  -emit-ast     write <file>.ast, which contains the Abstract Syntax Tree(AST)\n";
+    std::cerr << "  -emit-llvm    write <file>.ir, which contains the generated LLVM IR code\n";
+    std::cerr << "  -emit-bc      write <file>.bc, which contains the generated LLVM bitcode\n";
+    std::cerr << "  -S            write <file>.s, which contains the native assembly code\n";
+    std::cerr << "  -c            write <file>.o, which contains the native object code\n";
+    std::cerr << "  -o <path>     write the only requested output to <path>\n";
+    std::cerr << "  -j <n>        compile <n> files at the same time,\n";
+    std::cerr << "                the default is one per hardware thread\n";
+    std::cerr << "  --run         execute the program in-process with a JIT,\n";
+    std::cerr << "                nothing is written unless requested\n";
+    std::cerr << "  -lazy         with --run, compile each function when it is first called\n";
+    std::cerr << "  -speculate <n>\n";
+    std::cerr << "                with --run, compile likely callees lazily on <n> threads\n";
+    std::cerr << "  -O0 ... -O3   optimization level, the default is -O0\n";
+    std::cerr << "  -Os           optimize like -O2 but for code size\n";
+    std::cerr << "  -per-function-opt\n";
+    std::cerr << "                optimize each function right after it is generated\n";
+    std::cerr << "                instead of the whole module at the end, followed by\n";
+    std::cerr << "                cheap module passes only: inlining from -O2, no vectorization\n";
+    std::cerr << "  -mllvm <opt>  pass <opt> to LLVM, e.g. -mllvm -debug-pass=Structure\n";
+    std::cerr << "  -cache-dir <dir>\n";
+    std::cerr << "                reuse the LLVM IR, bitcode, assembly and object code\n";
+    std::cerr << "                of identical compilations from <dir>\n";
+    std::cerr << "  -cache-size <MB>\n";
+    std::cerr << "                remove the least recently used entries above <MB>,\n";
+    std::cerr << "                the default is 1024\n";
+    std::cerr << "  -cache-stats  print the cache hits and misses\n";
+    std::cerr << "  -incremental  with -cache-dir, reuse the optimized code of every function\n";
+    std::cerr << "                whose tokens and dependencies did not change,\n";
+    std::cerr << "                implies -per-function-opt\n";
+    std::cerr << "  -time-phases  print the wall-clock and CPU time of every compiler phase\n";
+    std::cerr << "  -time-phases-json <path>\n";
+    std::cerr << "                write the phase times to <path> as JSON\n";
+    std::cerr << "  -mem-report   print the peak memory of every phase, the AST nodes by class,\n";
+    std::cerr << "                the symbol tables and the size of the LLVM modules\n";
+    std::cerr << "  -perf-counters\n";
+    std::cerr << "                print the instructions, cycles, cache and branch misses\n";
+    std::cerr << "                of every phase from the hardware performance counters\n";
+    std::cerr << "  -ftime-trace  write <file>.json, which contains a Chrome trace of the phases,\n";
+    std::cerr << "                functions, statements and LLVM passes, compiles one file at a time\n";
+    std::cerr << "  -ftime-trace-granularity <us>\n";
+    std::cerr << "                leave out the events shorter than <us> microseconds,\n";
+    std::cerr << "                the default is 500\n";
+    std::cerr << "  --serve <socket>\n";
+    std::cerr << "                compile the requests of build/client on a Unix socket,\n";
+    std::cerr << "                <n> at a time with -j <n>\n";
+    std::cerr << "  --fork-server read lines of options and files from stdin, fork a compilation\n";
+    std::cerr << "                for each and reply its exit status, or \"signal <n>\", on stdout\n";
+    std::cerr << "Only the requested outputs are generated, -emit-llvm is the default.\n";
 }
 
 int main(int argc, const char *argv[])
 {
-    if (argc != 2)
+    Options opts;
+    if (!opts.Parse(argc, argv))
     {
         ShowHelp(argv[0]);
-        return 0;
+        return 1;
     }
-    std::string file(argv[1]);
-    if (file == "-h" || file == "--help")
+    if (opts.Help)
     {
         ShowHelp(argv[0]);
         return 0;
     }
+    if (!opts.LLVMArgs.empty())
+    {
+        std::vector<const char *> args{argv[0]};
+        for (const auto &arg : opts.LLVMArgs)
+            args.push_back(arg.c_str());
+        llvm::cl::ParseCommandLineOptions(args.size(), args.data());
+    }
 
-    std::ifstream input1(file);
-    std::ofstream lexOutput(file + ".lex");
-    TestScanner(input1, lexOutput);
-
-    std::error_code ec;
-    std::ifstream input2(file);
-    std::ofstream astOutput(file + ".ast");
-    llvm::raw_fd_ostream irOutput(file + ".ir", ec);
-    TestLLVM(input2, astOutput, irOutput);
-
-    return 0;
+    if (!opts.Serve.empty())
+    {
+        server::Server server(opts.Serve, opts.Jobs);
+        if (!server.Listen())
+            return 1;
+        server.Serve();
+        return 1;
+    }
+    if (opts.ForkServer)
+        return server::ForkServer::Serve(std::cin, std::cout, CompileInputs);
+    return CompileInputs(opts);
 }
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cxxabi.h>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include "AST/AST.hpp"
+
+// Where the memory of the compilations goes, collected with -mem-report: the AST nodes by class,
+// the symbol tables and the size of the LLVM modules. Like PhaseTimer, the code only collects while
+// a report is installed on its thread, and several threads may share one report
+class MemoryReport
+{
+public:
+    struct Usage
+    {
+        size_t Count = 0, Bytes = 0;
+    };
+    struct ModuleSize
+    {
+        std::string Stage;
+        size_t Modules = 0, Functions = 0, Blocks = 0, Instructions = 0;
+        // Memory traffic of the generated code
+        size_t Allocas = 0, Loads = 0, Stores = 0;
+    };
+
+private:
+    std::map<std::string, Usage> _Nodes;
+    size_t _Scopes = 0, _Symbols = 0;
+    // In the order the stages first ran
+    std::vector<ModuleSize> _Modules;
+    mutable std::mutex _Mutex;
+
+    inline static MemoryReport *&Slot()
+    {
+        thread_local MemoryReport *report = nullptr;
+        return report;
+    }
+
+    inline static std::string ClassName(const std::type_info &type)
+    {
+        int status;
+        auto demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+        std::string name = status == 0 ? demangled : type.name();
+        std::free(demangled);
+        if (name.compare(0, 5, "ast::") == 0)
+            name.erase(0, 5);
+        return name;
+    }
+
+public:
+    // The report of the calling thread, nullptr if -mem-report is off
+    inline static MemoryReport *GetCurrent() { return Slot(); }
+
+    class Install
+    {
+    private:
+        MemoryReport *_Previous;
+
+    public:
+        inline explicit Install(MemoryReport *report) : _Previous(Slot()) { Slot() = report; }
+        inline ~Install() { Slot() = _Previous; }
+        Install(const Install &) = delete;
+        Install &operator=(const Install &) = delete;
+    };
+
+    // Records the AST nodes allocated on the calling thread while a report is installed.
+    // It must outlive the nodes, which remove themselves when they are deleted
+    class TrackNodes
+    {
+    private:
+        std::unordered_map<void *, size_t> _Nodes;
+        std::unordered_map<void *, size_t> *_Previous;
+        bool _Tracking;
+
+    public:
+        inline TrackNodes() : _Previous(ast::Base::TrackedNodes()), _Tracking(GetCurrent())
+        {
+            if (_Tracking)
+                ast::Base::TrackedNodes() = &_Nodes;
+        }
+        inline ~TrackNodes()
+        {
+            if (_Tracking)
+                ast::Base::TrackedNodes() = _Previous;
+        }
+        TrackNodes(const TrackNodes &) = delete;
+        TrackNodes &operator=(const TrackNodes &) = delete;
+
+        // The nodes must be fully constructed
+        inline std::map<std::string, Usage> Count() const
+        {
+            std::map<std::string, Usage> usage;
+            for (auto [node, size] : _Nodes)
+            {
+                // Every node class derives from Base alone, so Base is at the start of the allocation
+                auto &u = usage[ClassName(typeid(*static_cast<ast::Base *>(node)))];
+                ++u.Count;
+                u.Bytes += size;
+            }
+            return usage;
+        }
+    };
+
+    inline void AddNodes(const TrackNodes &nodes)
+    {
+        auto usage = nodes.Count();
+        std::lock_guard<std::mutex> lock(_Mutex);
+        for (const auto &[name, u] : usage)
+        {
+            _Nodes[name].Count += u.Count;
+            _Nodes[name].Bytes += u.Bytes;
+        }
+    }
+
+    inline void AddSymbols(const ast::DeclarationList &program)
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _Scopes += program.GetSymbolScopes();
+        _Symbols += program.GetSymbolCount();
+    }
+
+    inline void AddModule(const char *stage, const llvm::Module &mod)
+    {
+        ModuleSize size{stage, 1};
+        for (const auto &f : mod)
+        {
+            if (f.isDeclaration())
+                continue;
+            ++size.Functions;
+            size.Blocks += f.size();
+            size.Instructions += f.getInstructionCount();
+            for (const auto &block : f)
+                for (const auto &inst : block)
+                {
+                    size.Allocas += llvm::isa<llvm::AllocaInst>(inst);
+                    size.Loads += llvm::isa<llvm::LoadInst>(inst);
+                    size.Stores += llvm::isa<llvm::StoreInst>(inst);
+                }
+        }
+        std::lock_guard<std::mutex> lock(_Mutex);
+        auto iter = std::find_if(_Modules.begin(), _Modules.end(),
+                                 [stage](const ModuleSize &m) { return m.Stage == stage; });
+        if (iter == _Modules.end())
+            iter = _Modules.insert(iter, ModuleSize{stage});
+        iter->Modules += size.Modules;
+        iter->Functions += size.Functions;
+        iter->Blocks += size.Blocks;
+        iter->Instructions += size.Instructions;
+        iter->Allocas += size.Allocas;
+        iter->Loads += size.Loads;
+        iter->Stores += size.Stores;
+    }
+
+    inline void Print(std::ostream &os) const
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        std::vector<std::pair<std::string, Usage>> nodes(_Nodes.begin(), _Nodes.end());
+        std::stable_sort(nodes.begin(), nodes.end(),
+                         [](const auto &a, const auto &b) { return a.second.Bytes > b.second.Bytes; });
+        Usage total;
+        for (const auto &n : nodes)
+        {
+            total.Count += n.second.Count;
+            total.Bytes += n.second.Bytes;
+        }
+        nodes.emplace_back("total", total);
+
+        os << "===-----------------------------------------------===\n";
+        os << "                Compiler memory report\n";
+        os << "===-----------------------------------------------===\n";
+        os << std::setw(12) << "Count" << std::setw(14) << "Bytes" << "  AST node\n";
+        for (const auto &[name, u] : nodes)
+            os << std::setw(12) << u.Count << std::setw(14) << u.Bytes << "  " << name << '\n';
+        os << "Symbol tables: " << _Scopes << " scopes, " << _Symbols << " symbols\n";
+        for (const auto &m : _Modules)
+            os << "LLVM modules after " << m.Stage << ": " << m.Modules << " modules, " << m.Functions
+               << " functions, " << m.Blocks << " basic blocks, " << m.Instructions << " instructions, "
+               << m.Allocas << " allocas, " << m.Loads << " loads, " << m.Stores << " stores\n";
+    }
+};
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Scanner/Scanner.ih"
+#include "Scanner/Lexer.hpp"
+#include "Scanner/TokenTape.hpp"
+#include "Parser/Parser.ih"
+#include "SymbolTable.hpp"
+
+// Isolated benchmarks of the hot paths of the compiler. Every benchmark is sampled several
+// times after a warm-up run, and the fastest and the median time per operation are printed,
+// which are stable from run to run on an idle machine
+
+using Clock = std::chrono::steady_clock;
+
+// Runs one sample and returns its seconds, the sample may prepare its data before `start`
+using Sample = std::function<double()>;
+
+inline double Seconds(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+const unsigned int Samples = 15;
+
+void Measure(const std::string &name, double operations, const std::string &unit, const Sample &sample)
+{
+    sample();
+    std::vector<double> times;
+    for (unsigned int i = 0; i < Samples; ++i)
+        times.push_back(sample());
+    std::sort(times.begin(), times.end());
+    auto best = times.front() / operations * 1e9, median = times[times.size() / 2] / operations * 1e9;
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << best << std::setw(12) << median << "  ns/" << unit << '\n';
+}
+
+// The test programs repeated until they are at least `size` bytes
+std::string Corpus(const std::vector<std::string> &paths, size_t size)
+{
+    std::string programs;
+    for (const auto &path : paths)
+    {
+        std::ifstream input(path);
+        std::ostringstream ss;
+        ss << input.rdbuf();
+        programs += ss.str() + '\n';
+    }
+    std::string corpus;
+    while (!programs.empty() && corpus.size() < size)
+        corpus += programs;
+    return corpus;
+}
+
+void BenchScanner(const std::string &corpus)
+{
+    size_t count = TokenTape(corpus).GetTokens().size();
+    std::ostringstream discarded;
+    Measure("Scanner::lex", count, "token", [&]() {
+        std::istringstream input(corpus);
+        Scanner s(input, discarded);
+        auto start = Clock::now();
+        while (s.lex() != 0)
+            ;
+        return Seconds(start);
+    });
+    Measure("Lexer::Lex", count, "token", [&]() {
+        auto start = Clock::now();
+        Lexer lexer(corpus);
+        while (lexer.Lex() != 0)
+            ;
+        return Seconds(start);
+    });
+}
+
+void BenchParser(const std::string &corpus)
+{
+    TokenTape tokens(corpus);
+    Measure("Parser::parse", tokens.GetTokens().size(), "token", [&]() {
+        // The parser consumes the tape, and the AST is freed outside of the measurement
+        TokenTape copy(tokens);
+        Parser p(copy);
+        auto start = Clock::now();
+        p.parse();
+        auto seconds = Seconds(start);
+        p.GetRoot();
+        return seconds;
+    });
+}
+
+void BenchSymbolTable(llvm::LLVMContext &context)
+{
+    auto value = llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), 0);
+    for (unsigned int depth : {1, 10, 100, 1000})
+        for (unsigned int symbols : {1, 16, 256})
+        {
+            // Each scope declares its own names, the lookup finds one of the outermost scope
+            ast::SymbolTable root;
+            auto scope = &root;
+            for (unsigned int d = 0; d < depth; ++d)
+            {
+                for (unsigned int s = 0; s < symbols; ++s)
+                    scope->AddSymbol("v" + std::to_string(d) + '_' + std::to_string(s), value);
+                if (d + 1 < depth)
+                    scope = scope->AddChild();
+            }
+            const std::string name = "v0_" + std::to_string(symbols / 2);
+            const unsigned int lookups = std::max(100000u / depth, 100u);
+            std::ostringstream label;
+            label << "SymbolTable::Search depth=" << depth << " n=" << symbols;
+            Measure(label.str(), lookups, "lookup", [&]() {
+                auto start = Clock::now();
+                for (unsigned int i = 0; i < lookups; ++i)
+                    if (!scope->Search(name))
+                        std::abort();
+                return Seconds(start);
+            });
+        }
+}
+
+// A function to generate code into, which is erased after every sample
+class Throwaway
+{
+private:
+    llvm::Function *_Function;
+
+public:
+    llvm::IRBuilder<> Builder;
+    ast::SymbolTable Symbols;
+    llvm::Value *A, *B;
+    // The first argument, an i32 value
+    llvm::Value *Arg;
+
+    inline explicit Throwaway(llvm::Module &mod) : Builder(mod.getContext())
+    {
+        auto &context = mod.getContext();
+        auto int32 = llvm::Type::getInt32Ty(context);
+        auto type = llvm::FunctionType::get(int32, {int32, int32}, false);
+        _Function = llvm::Function::Create(type, llvm::Function::ExternalLinkage, "throwaway", mod);
+        Builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", _Function));
+        A = Builder.CreateAlloca(int32);
+        B = Builder.CreateAlloca(int32);
+        Arg = _Function->getArg(0);
+        Builder.CreateStore(Arg, A);
+        Builder.CreateStore(_Function->getArg(1), B);
+        Symbols.AddSymbol("a", A);
+        Symbols.AddSymbol("b", B);
+    }
+    inline ~Throwaway() { _Function->eraseFromParent(); }
+};
+
+void BenchCodeGen(llvm::Module &mod)
+{
+    auto &context = mod.getContext();
+    const unsigned int count = 10000;
+    ErrorHandler::Location loc;
+    // Implicit casts print warnings, which are part of the cost but not of the output
+    std::ostringstream warnings;
+    ErrorHandler::Redirect redirect(warnings);
+
+    using Cast = std::pair<const char *, llvm::Type *>;
+    for (auto [name, type] : {Cast("i32 -> i64", llvm::Type::getInt64Ty(context)),
+                              Cast("i32 -> double", llvm::Type::getDoubleTy(context)),
+                              Cast("i32 -> i1", llvm::Type::getInt1Ty(context))})
+    {
+        Measure(std::string("Expression::CastLLVMType ") + name, count, "cast", [&, type = type]() {
+            Throwaway f(mod);
+            ast::SymbolTable::Symbol sym(f.Arg, false);
+            auto start = Clock::now();
+            for (unsigned int i = 0; i < count; ++i)
+                ast::Expression::CastLLVMType(sym, type, false, loc, f.Builder);
+            auto seconds = Seconds(start);
+            warnings.str("");
+            return seconds;
+        });
+    }
+
+    // a + b * 3
+    ast::ptr<ast::Base> a = std::make_unique<ast::ID>("a", loc), b = std::make_unique<ast::ID>("b", loc);
+    ast::ptr<ast::Base> left = std::make_unique<ast::Variable>(a), right = std::make_unique<ast::Variable>(b);
+    ast::ptr<ast::Base> three = std::make_unique<ast::Constant>(3, loc);
+    ast::ptr<ast::Base> mul = std::make_unique<ast::BiOpExpr>(right, three, ast::BiOpExpr::MUL);
+    ast::BiOpExpr add(left, mul, ast::BiOpExpr::ADD);
+    Measure("BiOpExpr::CodeGen a + b * 3", count, "expr", [&]() {
+        Throwaway f(mod);
+        auto start = Clock::now();
+        for (unsigned int i = 0; i < count; ++i)
+            add.CodeGen(f.Symbols, context, f.Builder);
+        return Seconds(start);
+    });
+}
+
+int main(int argc, const char *argv[])
+{
+    std::vector<std::string> paths(argv + 1, argv + argc);
+    if (paths.empty())
+        for (int i = 1; std::ifstream("tests/Basic/Test" + std::to_string(i) + "/test.cc"); ++i)
+            paths.push_back("tests/Basic/Test" + std::to_string(i) + "/test.cc");
+    auto corpus = Corpus(paths, 1 << 20);
+    if (corpus.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [file]...\n";
+        std::cerr << "  Run the microbenchmarks on the files, tests/Basic by default\n";
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(36) << "Benchmark" << std::right << std::setw(12) << "Fastest"
+              << std::setw(12) << "Median" << '\n';
+    BenchScanner(corpus);
+    BenchParser(corpus);
+    llvm::LLVMContext context;
+    llvm::Module mod("MicroBench", context);
+    BenchSymbolTable(context);
+    BenchCodeGen(mod);
+    return 0;
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <string>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+#include <thread>
+#include "ErrorHandler.hpp"
+
+class Options
+{
+public:
+    std::vector<std::string> Inputs;
+    // Empty if -o is not given, each output then goes next to its input file
+    std::string Output;
+    // Number of files compiled at the same time, 0 means one per hardware thread.
+    // With --serve, the number of requests compiled at the same time
+    unsigned int Jobs = 0;
+    // Socket path of the compile server, empty if not serving
+    std::string Serve;
+    // Read command lines from stdin and fork a compilation for each of them
+    bool ForkServer = false;
+    // Reuse the outputs of identical compilations from this directory, empty if not caching
+    std::string CacheDir;
+    unsigned long CacheSizeMB = 1024;
+    bool CacheStats = false;
+    // Reuse the code of unchanged functions from the cache, implies PerFunctionOpt
+    bool Incremental = false;
+    // Report the time of every compiler phase on stderr, and as JSON if the path is not empty
+    bool TimePhases = false;
+    std::string TimePhasesJSON;
+    // Write a Chrome trace of every input to <file>.json, with the events of at least
+    // TimeTraceGranularity microseconds
+    bool TimeTrace = false;
+    // Report the peak memory of every phase and what the compiler keeps in memory
+    bool MemReport = false;
+    // Read the hardware performance counters around every phase
+    bool HardwareCounters = false;
+    unsigned int TimeTraceGranularity = 500;
+    bool Help = false;
+    // Execute the program with a JIT after compiling it
+    bool Run = false;
+    // Compile each function when it is first called, and compile likely
+    // callees ahead on `SpeculateThreads` background threads
+    bool Lazy = false;
+    unsigned int SpeculateThreads = 0;
+    // Same meaning as in clang, -Os sets SizeLevel to 1
+    unsigned int OptLevel = 0, SizeLevel = 0;
+    // Optimize every function right after its codegen instead of the whole module at the end
+    bool PerFunctionOpt = false;
+    // Options passed to LLVM with -mllvm
+    std::vector<std::string> LLVMArgs;
+
+    bool EmitTokens = false;
+    bool EmitAST = false;
+    bool EmitLLVM = false;
+    bool EmitBC = false;
+    bool EmitAsm = false;
+    bool EmitObj = false;
+
+    inline unsigned int OutputCount() const { return EmitTokens + EmitAST + EmitLLVM + EmitBC + EmitAsm + EmitObj; }
+    inline bool NeedModule() const { return EmitLLVM || EmitBC || EmitAsm || EmitObj || Run; }
+    inline bool NeedOptimize() const { return OptLevel > 0 || SizeLevel > 0; }
+    inline bool NeedTarget() const { return EmitAsm || EmitObj || NeedOptimize(); }
+    // The lazy JIT optimizes each function when it is first called, unless the functions are
+    // optimized during codegen or the whole module is optimized for the output files
+    inline bool OptimizeLazily() const { return Lazy && !PerFunctionOpt && OutputCount() == 0; }
+
+    inline std::string OutputPath(const std::string &input, const std::string &ext) const
+    {
+        if (!Output.empty())
+            return Output;
+        return input + ext;
+    }
+
+    // Returns false and prints the reason if the command line is invalid
+    inline bool Parse(int argc, const char *argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg(argv[i]);
+            if (arg == "-h" || arg == "--help")
+                Help = true;
+            else if (arg == "--run")
+                Run = true;
+            else if (arg == "-lazy")
+                Lazy = true;
+            else if (arg == "-speculate")
+            {
+                if (++i == argc)
+                    return PrintError("Missing thread count after '-speculate'");
+                if (!ParseNumber(argv[i], arg, 1, 256, SpeculateThreads))
+                    return false;
+            }
+            else if (arg == "-emit-tokens")
+                EmitTokens = true;
+            else if (arg == "-emit-ast")
+                EmitAST = true;
+            else if (arg == "-emit-llvm")
+                EmitLLVM = true;
+            else if (arg == "-emit-bc")
+                EmitBC = true;
+            else if (arg == "-S")
+                EmitAsm = true;
+            else if (arg == "-c")
+                EmitObj = true;
+            else if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' && '0' <= arg[2] && arg[2] <= '3')
+            {
+                OptLevel = arg[2] - '0';
+                SizeLevel = 0;
+            }
+            else if (arg == "-Os")
+            {
+                OptLevel = 2;
+                SizeLevel = 1;
+            }
+            else if (arg == "-per-function-opt")
+                PerFunctionOpt = true;
+            else if (arg == "-mllvm")
+            {
+                if (++i == argc)
+                    return PrintError("Missing option after '-mllvm'");
+                LLVMArgs.push_back(argv[i]);
+            }
+            else if (arg == "-j")
+            {
+                if (++i == argc)
+                    return PrintError("Missing job count after '-j'");
+                if (!ParseNumber(argv[i], arg, 0, 1024, Jobs))
+                    return false;
+            }
+            else if (arg == "--serve")
+            {
+                if (++i == argc)
+                    return PrintError("Missing socket path after '--serve'");
+                Serve = argv[i];
+            }
+            else if (arg == "-cache-dir")
+            {
+                if (++i == argc)
+                    return PrintError("Missing directory after '-cache-dir'");
+                CacheDir = argv[i];
+            }
+            else if (arg == "-cache-size")
+            {
+                if (++i == argc)
+                    return PrintError("Missing size after '-cache-size'");
+                if (!ParseNumber(argv[i], arg, 1, 1ul << 30, CacheSizeMB))
+                    return false;
+            }
+            else if (arg == "-cache-stats")
+                CacheStats = true;
+            else if (arg == "-incremental")
+                Incremental = true;
+            else if (arg == "-time-phases")
+                TimePhases = true;
+            else if (arg == "-time-phases-json")
+            {
+                if (++i == argc)
+                    return PrintError("Missing path after '-time-phases-json'");
+                TimePhasesJSON = argv[i];
+            }
+            else if (arg == "-mem-report")
+                MemReport = true;
+            else if (arg == "-perf-counters")
+                HardwareCounters = true;
+            else if (arg == "-ftime-trace")
+                TimeTrace = true;
+            else if (arg == "-ftime-trace-granularity")
+            {
+                if (++i == argc)
+                    return PrintError("Missing microseconds after '-ftime-trace-granularity'");
+                if (!ParseNumber(argv[i], arg, 0, 1000000000, TimeTraceGranularity))
+                    return false;
+            }
+            else if (arg == "--fork-server")
+                ForkServer = true;
+            else if (arg == "-o")
+            {
+                if (++i == argc)
+                    return PrintError("Missing path after '-o'");
+                Output = argv[i];
+            }
+            else if (arg.size() > 1 && arg[0] == '-')
+                return PrintError("Unknown option '" + arg + '\'');
+            else
+                Inputs.push_back(arg);
+        }
+        if (Jobs == 0)
+            Jobs = std::max(std::thread::hardware_concurrency(), 1u);
+        if (Help)
+            return true;
+        if (!Serve.empty() || ForkServer)
+            return Inputs.empty() || PrintError("A server does not take input files");
+        if (Inputs.empty())
+            return PrintError("No input file");
+        if (Inputs.size() > 1 && !Output.empty())
+            return PrintError("Cannot use '-o' with multiple input files");
+        if (Inputs.size() > 1 && Run)
+            return PrintError("'--run' accepts only one input file");
+        // The final LLVM IR is the default output, unless the program is run
+        if (OutputCount() == 0 && !Run)
+            EmitLLVM = true;
+        if (!Output.empty() && OutputCount() > 1)
+            return PrintError("Cannot use '-o' with multiple outputs");
+        // The trace goes to the path of -o as well
+        if (!Output.empty() && TimeTrace && OutputCount() > 0)
+            return PrintError("Cannot use '-o' with '-ftime-trace' and other outputs");
+        if ((Lazy || SpeculateThreads > 0) && !Run)
+            return PrintError("'-lazy' and '-speculate' require '--run'");
+        if (SpeculateThreads > 0)
+            Lazy = true;
+        // The time trace profiler of LLVM records a single thread
+        if (TimeTrace && SpeculateThreads > 0)
+            return PrintError("Cannot use '-ftime-trace' with '-speculate'");
+        if (TimeTrace)
+            Jobs = 1;
+        if ((CacheStats || Incremental) && CacheDir.empty())
+            return PrintError("'-cache-stats' and '-incremental' require '-cache-dir'");
+        // Every function is optimized and cached on its own, the module passes follow the link
+        if (Incremental)
+            PerFunctionOpt = true;
+        return true;
+    }
+
+private:
+    inline static bool PrintError(const std::string &msg)
+    {
+        ErrorHandler::Stream() << "Error: " << msg << '\n';
+        return false;
+    }
+
+    // Parses the whole of `text` as a decimal number from `min` to `max` into `value`,
+    // returns false and prints the reason if it is not one
+    template <typename T>
+    inline static bool ParseNumber(const char *text, const std::string &option, unsigned long min,
+                                   unsigned long max, T &value)
+    {
+        // strtoul would skip spaces and wrap a minus sign around
+        char *end = nullptr;
+        errno = 0;
+        auto number = '0' <= text[0] && text[0] <= '9' ? std::strtoul(text, &end, 10) : 0;
+        if (!end || *end != '\0' || errno == ERANGE || number < min || number > max)
+            return PrintError("Invalid value '" + std::string(text) + "' for '" + option + "', expected a number from " +
+                              std::to_string(min) + " to " + std::to_string(max));
+        value = static_cast<T>(number);
+        return true;
+    }
+};
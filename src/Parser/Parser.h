@@ -5,7 +5,7 @@
 // $insert baseclass
 #include "Parserbase.h"
 // $insert scanner.h
-#include "../Scanner/Scanner.h"
+#include "../Scanner/TokenTape.hpp"
 
 #undef Parser
 // CAVEAT: between the baseclass-include directive and the
@@ -24,7 +24,7 @@
 class Parser : public ParserBase
 {
 private:
-    Scanner *_Scanner;
+    TokenTape *_Tokens;
     std::unique_ptr<ast::Base> _Root;
 
 public:
@@ -39,7 +39,7 @@ public:
                                                          "XOR_ASSIGN", "EQ", "NE", "LE", "GE", "SHL", "SHR"};
     inline static constexpr unsigned int TOKEN_COUNT = sizeof(TOKEN_NAMES) / sizeof(*TOKEN_NAMES);
 
-    inline Parser(Scanner &scanner) : _Scanner(&scanner) {}
+    inline Parser(TokenTape &tokens) : _Tokens(&tokens) {}
     int parse();
 
     inline std::unique_ptr<ast::Base> GetRoot() { return std::move(_Root); }
@@ -55,9 +55,9 @@ private:
     }
     inline std::string MachedStr()
     {
-        if (_Scanner->matched() == "")
+        if (_Tokens->matched() == "")
             return "end of file";
-        return '"' + _Scanner->matched() + '"';
+        return '"' + std::string(_Tokens->matched()) + '"';
     }
     // called on (syntax) errors
     inline void error()
@@ -75,12 +75,12 @@ private:
                 ss << ", " << Tok2Str(validTokens[i]);
             ss << " or " << Tok2Str(validTokens.back()) << " before " << MachedStr();
         }
-        ErrorHandler::PrintError(ss.str(), _Scanner->GetLocation());
+        ErrorHandler::PrintError(ss.str(), _Tokens->GetLocation());
     }
 
     // returns the next token from the
-    // lexical scanner.
-    inline int lex() { return _Scanner->lex(); }
+    // token tape.
+    inline int lex() { return _Tokens->lex(); }
     // use, e.g., d_token, d_loc
     inline void print() const {}
     // Suppress all exceptions
@@ -26,18 +26,18 @@ Program:
 ;
 
 ID:
-  ID_TEXT  { $$ = std::make_unique<ast::ID>(_Scanner->matched(), _Scanner->GetLocation()); }
+  ID_TEXT  { $$ = std::make_unique<ast::ID>(_Tokens->matched(), _Tokens->GetLocation()); }
 ;
 
 PrimaryExpression:
-  TRUE                { $$ = std::make_unique<ast::Constant>(true, _Scanner->GetLocation());                                        }
-| FALSE               { $$ = std::make_unique<ast::Constant>(false, _Scanner->GetLocation());                                       }
-| CONSTCHAR           { $$ = std::make_unique<ast::Constant>(_Scanner->matched()[1], _Scanner->GetLocation());                      }
-| CONSTINT            { $$ = std::make_unique<ast::Constant>(std::stoi(_Scanner->matched()), _Scanner->GetLocation());              }
-| CONSTINT_BIN        { $$ = std::make_unique<ast::Constant>(std::stoi(_Scanner->matched(), nullptr, 2), _Scanner->GetLocation());  }
-| CONSTINT_OCT        { $$ = std::make_unique<ast::Constant>(std::stoi(_Scanner->matched(), nullptr, 8), _Scanner->GetLocation());  }
-| CONSTINT_HEX        { $$ = std::make_unique<ast::Constant>(std::stoi(_Scanner->matched(), nullptr, 16), _Scanner->GetLocation()); }
-| CONSTFP             { $$ = std::make_unique<ast::Constant>(std::stod(_Scanner->matched()), _Scanner->GetLocation());              }
+  TRUE                { $$ = std::make_unique<ast::Constant>(true, _Tokens->GetLocation());                                         }
+| FALSE               { $$ = std::make_unique<ast::Constant>(false, _Tokens->GetLocation());                                        }
+| CONSTCHAR           { $$ = std::make_unique<ast::Constant>(_Tokens->matched()[1], _Tokens->GetLocation());                                   }
+| CONSTINT            { $$ = std::make_unique<ast::Constant>(std::stoi(std::string(_Tokens->matched())), _Tokens->GetLocation());              }
+| CONSTINT_BIN        { $$ = std::make_unique<ast::Constant>(std::stoi(std::string(_Tokens->matched()), nullptr, 2), _Tokens->GetLocation());  }
+| CONSTINT_OCT        { $$ = std::make_unique<ast::Constant>(std::stoi(std::string(_Tokens->matched()), nullptr, 8), _Tokens->GetLocation());  }
+| CONSTINT_HEX        { $$ = std::make_unique<ast::Constant>(std::stoi(std::string(_Tokens->matched()), nullptr, 16), _Tokens->GetLocation()); }
+| CONSTFP             { $$ = std::make_unique<ast::Constant>(std::stod(std::string(_Tokens->matched())), _Tokens->GetLocation());              }
 | ID                  { $$ = std::make_unique<ast::Variable>($1);                                                                   }
 | '(' Expression ')'  { $$ = std::move($2);                                                                                         }
 | '(' error ')'       { $$ = nullptr;                                                                                               }
@@ -104,8 +104,8 @@ Statement:
 | IF '(' Expression ')' Statement ELSE Statement            { $$ = std::make_unique<ast::IfStmt>($3, $5, $7);                      }
 | WHILE '(' Expression ')' Statement                        { $$ = std::make_unique<ast::WhileStmt>($3, $5);                       }
 | FOR '(' Statement Expression ';'Expression ')' Statement  { $$ = std::make_unique<ast::ForStmt>($3, $4, $6, $8);                 }
-| RETURN ';'                                                { $$ = std::make_unique<ast::ReturnStmt>(_Scanner->GetLocation());     }
-| RETURN Expression ';'                                     { $$ = std::make_unique<ast::ReturnStmt>($2, _Scanner->GetLocation()); }
+| RETURN ';'                                                { $$ = std::make_unique<ast::ReturnStmt>(_Tokens->GetLocation());      }
+| RETURN Expression ';'                                     { $$ = std::make_unique<ast::ReturnStmt>($2, _Tokens->GetLocation());  }
 | '{' StatementList '}'                                     { $$ = std::move($2);                                                  }
 | '{' error '}'                                             { $$ = nullptr;                                                        }
 ;
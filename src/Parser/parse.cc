@@ -4136,39 +4136,39 @@ try
         break;
 
         case 2:
-        { d_val_ = std::make_unique<ast::ID>(_Scanner->matched(), _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::ID>(_Tokens->matched(), _Tokens->GetLocation()); }
         break;
 
         case 3:
-        { d_val_ = std::make_unique<ast::Constant>(true, _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::Constant>(true, _Tokens->GetLocation()); }
         break;
 
         case 4:
-        { d_val_ = std::make_unique<ast::Constant>(false, _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::Constant>(false, _Tokens->GetLocation()); }
         break;
 
         case 5:
-        { d_val_ = std::make_unique<ast::Constant>(_Scanner->matched()[1], _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::Constant>(_Tokens->matched()[1], _Tokens->GetLocation()); }
         break;
 
         case 6:
-        { d_val_ = std::make_unique<ast::Constant>(std::stoi(_Scanner->matched()), _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::Constant>(std::stoi(std::string(_Tokens->matched())), _Tokens->GetLocation()); }
         break;
 
         case 7:
-        { d_val_ = std::make_unique<ast::Constant>(std::stoi(_Scanner->matched(), nullptr, 2), _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::Constant>(std::stoi(std::string(_Tokens->matched()), nullptr, 2), _Tokens->GetLocation()); }
         break;
 
         case 8:
-        { d_val_ = std::make_unique<ast::Constant>(std::stoi(_Scanner->matched(), nullptr, 8), _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::Constant>(std::stoi(std::string(_Tokens->matched()), nullptr, 8), _Tokens->GetLocation()); }
         break;
 
         case 9:
-        { d_val_ = std::make_unique<ast::Constant>(std::stoi(_Scanner->matched(), nullptr, 16), _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::Constant>(std::stoi(std::string(_Tokens->matched()), nullptr, 16), _Tokens->GetLocation()); }
         break;
 
         case 10:
-        { d_val_ = std::make_unique<ast::Constant>(std::stod(_Scanner->matched()), _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::Constant>(std::stod(std::string(_Tokens->matched())), _Tokens->GetLocation()); }
         break;
 
         case 11:
@@ -4388,11 +4388,11 @@ try
         break;
 
         case 65:
-        { d_val_ = std::make_unique<ast::ReturnStmt>(_Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::ReturnStmt>(_Tokens->GetLocation()); }
         break;
 
         case 66:
-        { d_val_ = std::make_unique<ast::ReturnStmt>(vs_(-1), _Scanner->GetLocation()); }
+        { d_val_ = std::make_unique<ast::ReturnStmt>(vs_(-1), _Tokens->GetLocation()); }
         break;
 
         case 67:
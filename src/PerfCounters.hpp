@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware performance counters of the calling thread, read with perf_event_open.
+// Every thread opens its own counters on first use. A counter the kernel or the
+// machine does not provide, e.g. in most virtual machines, reads as unavailable
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        Instructions,
+        Cycles,
+        CacheReferences,
+        CacheMisses,
+        Branches,
+        BranchMisses,
+        EventCount
+    };
+
+    // Names of the events in the JSON output of PhaseTimer
+    inline static const char *const EventNames[EventCount] = {"instructions", "cycles", "cache_references",
+                                                              "cache_misses", "branches", "branch_misses"};
+
+    struct Values
+    {
+        uint64_t Value[EventCount] = {};
+        bool Available[EventCount] = {};
+
+        inline Values &operator+=(const Values &other)
+        {
+            for (int i = 0; i < EventCount; ++i)
+            {
+                Value[i] += other.Value[i];
+                Available[i] = Available[i] || other.Available[i];
+            }
+            return *this;
+        }
+        inline Values operator-(const Values &start) const
+        {
+            Values diff;
+            for (int i = 0; i < EventCount; ++i)
+            {
+                diff.Value[i] = Value[i] - start.Value[i];
+                diff.Available[i] = Available[i] && start.Available[i];
+            }
+            return diff;
+        }
+    };
+
+private:
+    // The events are opened in pairs whose ratio is printed, instructions with cycles, cache misses
+    // with references and branch misses with branches. The kernel schedules each pair as a group,
+    // so both counts cover the same time even when the counters are multiplexed
+    static constexpr int GroupCount = EventCount / 2;
+    int _FDs[EventCount];
+    // Events of each group in the order they are read, the leader first
+    int _GroupEvents[GroupCount][2];
+    int _GroupSizes[GroupCount] = {};
+    // Reason why no counter could be opened, empty if some are available
+    std::string _Error;
+
+    inline int Open(Event event, int groupFD)
+    {
+        static const uint64_t configs[EventCount] = {
+            PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_REFERENCES,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[event];
+        // Only the compiler itself, which also works with perf_event_paranoid 2
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // The groups may be multiplexed when there are more counters than the PMU has
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, groupFD, PERF_FLAG_FD_CLOEXEC);
+        if (fd < 0 && _Error.empty())
+            _Error = std::strerror(errno);
+        return fd;
+    }
+
+    inline PerfCounters()
+    {
+        bool any = false;
+        for (int g = 0; g < GroupCount; ++g)
+        {
+            // If the first event is missing, the second one leads a group of its own
+            int leader = -1;
+            for (int i = 2 * g; i < 2 * g + 2; ++i)
+            {
+                _FDs[i] = Open(static_cast<Event>(i), leader);
+                if (_FDs[i] < 0)
+                    continue;
+                if (leader < 0)
+                    leader = _FDs[i];
+                _GroupEvents[g][_GroupSizes[g]++] = i;
+                any = true;
+            }
+        }
+        if (any)
+            _Error.clear();
+    }
+
+public:
+    inline ~PerfCounters()
+    {
+        for (auto fd : _FDs)
+            if (fd >= 0)
+                close(fd);
+    }
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // The counters of the calling thread
+    inline static PerfCounters &ForThread()
+    {
+        thread_local PerfCounters counters;
+        return counters;
+    }
+
+    inline bool IsAvailable() const { return _Error.empty(); }
+    inline const std::string &GetError() const { return _Error; }
+
+    // Counts since the counters were opened, scaled up if they were multiplexed
+    inline Values Read() const
+    {
+        Values values;
+        for (int g = 0; g < GroupCount; ++g)
+        {
+            if (_GroupSizes[g] == 0)
+                continue;
+            // Number of events, time enabled, time running and the value of each event
+            uint64_t data[3 + 2];
+            auto size = static_cast<ssize_t>((3 + _GroupSizes[g]) * sizeof(uint64_t));
+            if (read(_FDs[_GroupEvents[g][0]], data, size) != size || data[0] != static_cast<uint64_t>(_GroupSizes[g]))
+                continue;
+            for (int j = 0; j < _GroupSizes[g]; ++j)
+            {
+                auto i = _GroupEvents[g][j];
+                values.Available[i] = true;
+                if (data[2] > 0 && data[2] < data[1])
+                    values.Value[i] = static_cast<uint64_t>(static_cast<double>(data[3 + j]) * data[1] / data[2]);
+                else
+                    values.Value[i] = data[3 + j];
+            }
+        }
+        return values;
+    }
+};
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <sys/resource.h>
+#include <llvm/Support/TimeProfiler.h>
+#include "PerfCounters.hpp"
+
+// Wall-clock and CPU time and peak memory of the compiler phases. Code marks a phase with a PhaseTimer::Scope,
+// which measures only while a timer is installed on its thread, so the library pays nothing
+// when timing is off. Several threads may share one timer, their times add up.
+// With counters enabled, a scope also reads the hardware performance counters of its thread.
+// A scope is also an event of the LLVM time trace profiler when it is enabled
+class PhaseTimer
+{
+public:
+    struct Phase
+    {
+        std::string Name;
+        double Wall = 0, CPU = 0;
+        unsigned int Count = 0;
+        // Peak resident set size of the process at the end of the phase,
+        // and how much the phase raised it, in KB
+        long PeakRSS = 0, RSSGrowth = 0;
+        PerfCounters::Values Counters;
+    };
+
+private:
+    // In the order the phases first ran
+    std::vector<Phase> _Phases;
+    std::chrono::steady_clock::time_point _Start = std::chrono::steady_clock::now();
+    double _StartCPU = ProcessCPUTime();
+    long _StartRSS = PeakRSS();
+    bool _CountEvents = false;
+    mutable std::mutex _Mutex;
+
+    inline static PhaseTimer *&Slot()
+    {
+        thread_local PhaseTimer *timer = nullptr;
+        return timer;
+    }
+
+    inline static double CPUTime(clockid_t clock)
+    {
+        timespec ts;
+        clock_gettime(clock, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    inline void Add(const Phase &sample)
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        auto phase = _Phases.begin();
+        while (phase != _Phases.end() && phase->Name != sample.Name)
+            ++phase;
+        if (phase == _Phases.end())
+            phase = _Phases.insert(phase, Phase{sample.Name});
+        phase->Wall += sample.Wall;
+        phase->CPU += sample.CPU;
+        ++phase->Count;
+        phase->PeakRSS = std::max(phase->PeakRSS, sample.PeakRSS);
+        phase->RSSGrowth += sample.RSSGrowth;
+        phase->Counters += sample.Counters;
+    }
+
+public:
+    inline static double ThreadCPUTime() { return CPUTime(CLOCK_THREAD_CPUTIME_ID); }
+    inline static double ProcessCPUTime() { return CPUTime(CLOCK_PROCESS_CPUTIME_ID); }
+
+    // Peak resident set size of the process so far in KB
+    inline static long PeakRSS()
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    inline PhaseTimer(bool countEvents = false) : _CountEvents(countEvents) {}
+
+    // The timer of the calling thread, nullptr if timing is off
+    inline static PhaseTimer *GetCurrent() { return Slot(); }
+
+    // Times the phases of the calling thread with `timer` while it is alive
+    class Install
+    {
+    private:
+        PhaseTimer *_Previous;
+
+    public:
+        inline explicit Install(PhaseTimer *timer) : _Previous(Slot()) { Slot() = timer; }
+        inline ~Install() { Slot() = _Previous; }
+        Install(const Install &) = delete;
+        Install &operator=(const Install &) = delete;
+    };
+
+    // Adds the time until its destruction to the phase `name`, which must be a literal
+    class Scope
+    {
+    private:
+        PhaseTimer *_Timer;
+        const char *_Name;
+        bool _Traced;
+        std::chrono::steady_clock::time_point _Start;
+        double _StartCPU = 0;
+        long _StartRSS = 0;
+        PerfCounters::Values _StartCounters;
+
+    public:
+        inline explicit Scope(const char *name)
+            : _Timer(Slot()), _Name(name), _Traced(llvm::timeTraceProfilerEnabled())
+        {
+            if (_Traced)
+                llvm::timeTraceProfilerBegin(name, "");
+            if (!_Timer)
+                return;
+            _Start = std::chrono::steady_clock::now();
+            _StartCPU = ThreadCPUTime();
+            _StartRSS = PeakRSS();
+            // Read last, so that the counters include as little of the timer as possible
+            if (_Timer->_CountEvents)
+                _StartCounters = PerfCounters::ForThread().Read();
+        }
+        inline ~Scope() { Stop(); }
+
+        // Ends the phase before the end of the scope
+        inline void Stop()
+        {
+            if (_Traced)
+                llvm::timeTraceProfilerEnd();
+            _Traced = false;
+            if (!_Timer)
+                return;
+            PerfCounters::Values counters;
+            if (_Timer->_CountEvents)
+                counters = PerfCounters::ForThread().Read() - _StartCounters;
+            std::chrono::duration<double> wall = std::chrono::steady_clock::now() - _Start;
+            auto rss = PeakRSS();
+            _Timer->Add(Phase{_Name, wall.count(), ThreadCPUTime() - _StartCPU, 1, rss, rss - _StartRSS, counters});
+            _Timer = nullptr;
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    inline std::vector<Phase> GetPhases() const
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        return _Phases;
+    }
+
+    // Wall-clock and CPU time of the whole process since the timer was created,
+    // the counters are the sum of the phases
+    inline Phase GetTotal() const
+    {
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - _Start;
+        auto rss = PeakRSS();
+        Phase total{"total", wall.count(), ProcessCPUTime() - _StartCPU, 1, rss, rss - _StartRSS};
+        for (const auto &p : GetPhases())
+            total.Counters += p.Counters;
+        return total;
+    }
+
+    inline void PrintTable(std::ostream &os) const
+    {
+        auto phases = GetPhases();
+        auto total = GetTotal();
+        auto row = [&os](const Phase &p) {
+            os << std::setw(12) << p.Wall << std::setw(12) << p.CPU << std::setw(8) << p.Count << "  " << p.Name << '\n';
+        };
+        os << "===-----------------------------------------------===\n";
+        os << "                Compiler phase times\n";
+        os << "===-----------------------------------------------===\n";
+        os << std::fixed << std::setprecision(4);
+        os << std::setw(12) << "Wall (s)" << std::setw(12) << "CPU (s)" << std::setw(8) << "Count" << "  Phase\n";
+        for (const auto &p : phases)
+            row(p);
+        row(total);
+        os.unsetf(std::ios::floatfield);
+    }
+
+    inline void PrintMemoryTable(std::ostream &os) const
+    {
+        auto phases = GetPhases();
+        auto total = GetTotal();
+        auto row = [&os](const Phase &p) {
+            os << std::setw(14) << p.PeakRSS / 1024.0 << std::setw(14) << p.RSSGrowth / 1024.0 << "  " << p.Name << '\n';
+        };
+        os << "===-----------------------------------------------===\n";
+        os << "                Compiler phase memory\n";
+        os << "===-----------------------------------------------===\n";
+        os << std::fixed << std::setprecision(1);
+        os << std::setw(14) << "Peak RSS (MB)" << std::setw(14) << "Growth (MB)" << "  Phase\n";
+        for (const auto &p : phases)
+            row(p);
+        row(total);
+        os.unsetf(std::ios::floatfield);
+    }
+
+    inline void PrintCounterTable(std::ostream &os) const
+    {
+        auto phases = GetPhases();
+        auto total = GetTotal();
+        const auto &perf = PerfCounters::ForThread();
+        if (!perf.IsAvailable())
+        {
+            os << "Note: Hardware performance counters are not available: " << perf.GetError() << '\n';
+            return;
+        }
+        auto row = [&os](const Phase &p) {
+            const auto &c = p.Counters;
+            // A count or a rate is "n/a" when one of its counters is not available
+            for (auto event : {PerfCounters::Instructions, PerfCounters::Cycles})
+            {
+                if (c.Available[event])
+                    os << std::setw(12) << c.Value[event] / 1e6;
+                else
+                    os << std::setw(12) << "n/a";
+            }
+            for (auto [a, b, scale] : {std::tuple(PerfCounters::Instructions, PerfCounters::Cycles, 1.0),
+                                       std::tuple(PerfCounters::CacheMisses, PerfCounters::CacheReferences, 100.0),
+                                       std::tuple(PerfCounters::BranchMisses, PerfCounters::Branches, 100.0)})
+            {
+                if (c.Available[a] && c.Available[b])
+                    os << std::setw(14) << (c.Value[b] == 0 ? 0.0 : scale * c.Value[a] / c.Value[b]);
+                else
+                    os << std::setw(14) << "n/a";
+            }
+            os << "  " << p.Name << '\n';
+        };
+        os << "===-----------------------------------------------===\n";
+        os << "                Compiler phase counters\n";
+        os << "===-----------------------------------------------===\n";
+        os << std::fixed << std::setprecision(2);
+        os << std::setw(12) << "Instr (M)" << std::setw(12) << "Cycles (M)" << std::setw(14) << "IPC"
+           << std::setw(14) << "Cache miss %" << std::setw(14) << "Branch miss %" << "  Phase\n";
+        for (const auto &p : phases)
+            row(p);
+        row(total);
+        os.unsetf(std::ios::floatfield);
+    }
+
+    inline void PrintJSON(std::ostream &os) const
+    {
+        auto phases = GetPhases();
+        auto total = GetTotal();
+        auto object = [&os](const Phase &p) {
+            os << "{\"name\": \"" << p.Name << "\", \"wall_seconds\": " << p.Wall << ", \"cpu_seconds\": " << p.CPU
+               << ", \"count\": " << p.Count << ", \"peak_rss_kb\": " << p.PeakRSS;
+            for (int i = 0; i < PerfCounters::EventCount; ++i)
+                if (p.Counters.Available[i])
+                    os << ", \"" << PerfCounters::EventNames[i] << "\": " << p.Counters.Value[i];
+            os << '}';
+        };
+        os << std::setprecision(9) << "{\n  \"phases\": [";
+        for (size_t i = 0; i < phases.size(); ++i)
+        {
+            os << (i == 0 ? "\n    " : ",\n    ");
+            object(phases[i]);
+        }
+        os << "\n  ],\n  \"total\": ";
+        object(total);
+        os << "\n}\n";
+    }
+};
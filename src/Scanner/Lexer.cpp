@@ -0,0 +1,332 @@
+#include "Lexer.hpp"
+
+#include <cstdint>
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "../Parser/Parser.h"
+
+namespace
+{
+#if defined(__AVX2__)
+    using Bytes = __m256i;
+    const long Width = 32;
+    inline Bytes Load(const char *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+    inline Bytes Splat(char c) { return _mm256_set1_epi8(c); }
+    inline Bytes Equal(Bytes b, char c) { return _mm256_cmpeq_epi8(b, Splat(c)); }
+    inline Bytes Greater(Bytes a, Bytes b) { return _mm256_cmpgt_epi8(a, b); }
+    inline Bytes Add(Bytes a, Bytes b) { return _mm256_add_epi8(a, b); }
+    inline Bytes And(Bytes a, Bytes b) { return _mm256_and_si256(a, b); }
+    inline Bytes Or(Bytes a, Bytes b) { return _mm256_or_si256(a, b); }
+    inline uint32_t Mask(Bytes b) { return _mm256_movemask_epi8(b); }
+#elif defined(__SSE2__)
+    using Bytes = __m128i;
+    const long Width = 16;
+    inline Bytes Load(const char *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+    inline Bytes Splat(char c) { return _mm_set1_epi8(c); }
+    inline Bytes Equal(Bytes b, char c) { return _mm_cmpeq_epi8(b, Splat(c)); }
+    inline Bytes Greater(Bytes a, Bytes b) { return _mm_cmpgt_epi8(a, b); }
+    inline Bytes Add(Bytes a, Bytes b) { return _mm_add_epi8(a, b); }
+    inline Bytes And(Bytes a, Bytes b) { return _mm_and_si128(a, b); }
+    inline Bytes Or(Bytes a, Bytes b) { return _mm_or_si128(a, b); }
+    inline uint32_t Mask(Bytes b) { return _mm_movemask_epi8(b); }
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    const uint32_t AllBytes = Width == 32 ? 0xffffffffu : 0xffffu;
+
+    // Bytes in [lo, hi]. The compares are signed, so the range is moved to start at -128
+    inline Bytes InRange(Bytes b, char lo, char hi)
+    {
+        auto shifted = Add(b, Splat(static_cast<char>(-128 - lo)));
+        return Greater(Splat(static_cast<char>(-128 + (hi - lo) + 1)), shifted);
+    }
+
+    inline Bytes IsWhitespace(Bytes b) { return Or(Or(Equal(b, ' '), Equal(b, '\t')), Equal(b, '\n')); }
+    inline Bytes IsDigit(Bytes b) { return InRange(b, '0', '9'); }
+    inline Bytes IsIdentifier(Bytes b)
+    {
+        // Setting bit 5 maps the upper case letters to the lower case ones, and no other byte to them
+        auto letter = InRange(Or(b, Splat(0x20)), 'a', 'z');
+        return Or(Or(letter, IsDigit(b)), Equal(b, '_'));
+    }
+#endif
+
+    inline bool IsWhitespace(char c) { return c == ' ' || c == '\t' || c == '\n'; }
+    inline bool IsDigit(char c) { return '0' <= c && c <= '9'; }
+    inline bool IsIdentifierStart(char c) { return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_'; }
+    inline bool IsIdentifier(char c) { return IsIdentifierStart(c) || IsDigit(c); }
+    inline bool IsHex(char c) { return IsDigit(c) || ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F'); }
+
+    // The first byte in [p, end) that is not in the class, or end. Whole vectors are
+    // tested while they fit in the buffer, the rest byte by byte
+    template <typename Class>
+    inline const char *SkipWhile(const char *p, const char *end, Class inClass)
+    {
+#if defined(__AVX2__) || defined(__SSE2__)
+        for (; end - p >= Width; p += Width)
+        {
+            auto stop = ~Mask(inClass(Load(p))) & AllBytes;
+            if (stop != 0)
+                return p + __builtin_ctz(stop);
+        }
+#endif
+        while (p < end && inClass(*p))
+            ++p;
+        return p;
+    }
+
+    inline const char *SkipWhitespace(const char *p, const char *end)
+    {
+        return SkipWhile(p, end, [](auto b) { return IsWhitespace(b); });
+    }
+    inline const char *SkipDigits(const char *p, const char *end)
+    {
+        return SkipWhile(p, end, [](auto b) { return IsDigit(b); });
+    }
+    inline const char *SkipIdentifier(const char *p, const char *end)
+    {
+        return SkipWhile(p, end, [](auto b) { return IsIdentifier(b); });
+    }
+
+    // The first '\n' in [p, end), or end
+    inline const char *FindNewline(const char *p, const char *end)
+    {
+        auto found = std::memchr(p, '\n', end - p);
+        return found ? static_cast<const char *>(found) : end;
+    }
+
+    // The first "*/" in [p, end), or end
+    inline const char *FindCommentEnd(const char *p, const char *end)
+    {
+#if defined(__AVX2__) || defined(__SSE2__)
+        // The second load reads one byte further
+        for (; end - p > Width; p += Width)
+        {
+            auto found = Mask(And(Equal(Load(p), '*'), Equal(Load(p + 1), '/')));
+            if (found != 0)
+                return p + __builtin_ctz(found);
+        }
+#endif
+        for (; end - p >= 2; ++p)
+            if (p[0] == '*' && p[1] == '/')
+                return p;
+        return end;
+    }
+
+    inline int Keyword(std::string_view text)
+    {
+        static const std::pair<std::string_view, int> keywords[] = {
+            {"void", Parser::VOID},     {"bool", Parser::BOOL},   {"char", Parser::CHAR},     {"short", Parser::SHORT},
+            {"int", Parser::INT},       {"long", Parser::LONG},   {"float", Parser::FLOAT},   {"double", Parser::DOUBLE},
+            {"true", Parser::TRUE},     {"false", Parser::FALSE}, {"return", Parser::RETURN}, {"if", Parser::IF},
+            {"else", Parser::ELSE},     {"while", Parser::WHILE}, {"struct", Parser::STRUCT}, {"for", Parser::FOR}};
+        if (text.size() < 2 || text.size() > 6)
+            return Parser::ID_TEXT;
+        for (const auto &[keyword, kind] : keywords)
+            if (keyword == text)
+                return kind;
+        return Parser::ID_TEXT;
+    }
+} // namespace
+
+void Lexer::Advance(const char *to)
+{
+    auto p = _Current;
+    const char *lastNewline = nullptr;
+    unsigned int newlines = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; to - p >= Width; p += Width)
+        if (auto found = Mask(Equal(Load(p), '\n')))
+        {
+            newlines += __builtin_popcount(found);
+            lastNewline = p + 31 - __builtin_clz(found);
+        }
+#endif
+    for (; p < to; ++p)
+        if (*p == '\n')
+        {
+            ++newlines;
+            lastNewline = p;
+        }
+    if (newlines > 0)
+    {
+        _Row += newlines;
+        _Column = to - lastNewline;
+    }
+    else
+        _Column += to - _Current;
+    _Current = to;
+}
+
+// Tokens never contain a newline
+int Lexer::Match(int kind, const char *end)
+{
+    unsigned int length = end - _Current;
+    _Matched = std::string_view(_Current, length);
+    _Location = ErrorHandler::Location(_Row, _Column, _Column + length);
+    _Column += length;
+    _Current = end;
+    return kind;
+}
+
+void Lexer::Unknown()
+{
+    // The flexc++ scanner reports the location before the character
+    ErrorHandler::PrintWarning("Unknown character ignored: " + std::string(1, *_Current),
+                               ErrorHandler::Location(_Row, _Column - 1, _Column));
+    ++_Current;
+    ++_Column;
+}
+
+// The longest of the number rules, and the first of them if several match as much
+int Lexer::Number(const char *begin)
+{
+    auto end = _End;
+    if (begin[0] == '0' && end - begin >= 3)
+    {
+        if ((begin[1] == 'b' || begin[1] == 'B') && (begin[2] == '0' || begin[2] == '1'))
+        {
+            auto p = begin + 2;
+            while (p < end && (*p == '0' || *p == '1'))
+                ++p;
+            return Match(Parser::CONSTINT_BIN, p);
+        }
+        if ((begin[1] == 'x' || begin[1] == 'X') && IsHex(begin[2]))
+        {
+            auto p = begin + 2;
+            while (p < end && IsHex(*p))
+                ++p;
+            return Match(Parser::CONSTINT_HEX, p);
+        }
+    }
+    // [0-9]+ or \.[0-9]+
+    auto digits = begin[0] == '.' ? SkipDigits(begin + 1, end) : SkipDigits(begin, end);
+    if (begin[0] == '.' || (digits < end && *digits == '.'))
+    {
+        auto p = begin[0] == '.' ? digits : SkipDigits(digits + 1, end);
+        if (p < end && *p == 'e')
+        {
+            auto exponent = p + 1;
+            if (exponent < end && (*exponent == '+' || *exponent == '-'))
+                ++exponent;
+            if (exponent < end && IsDigit(*exponent))
+                p = SkipDigits(exponent, end);
+        }
+        return Match(Parser::CONSTFP, p);
+    }
+    bool octal = begin[0] == '0' && digits - begin >= 2;
+    for (auto p = begin + 1; octal && p < digits; ++p)
+        octal = *p <= '7';
+    return Match(octal ? Parser::CONSTINT_OCT : Parser::CONSTINT, digits);
+}
+
+int Lexer::Lex()
+{
+    while (true)
+    {
+        Advance(SkipWhitespace(_Current, _End));
+        if (_Current == _End)
+            return Match(0, _End);
+
+        auto begin = _Current;
+        auto rest = _End - begin;
+        auto next = rest >= 2 ? begin[1] : '\0';
+        // The longest of op, op= and, for `twice`, opop and opop=
+        auto op = [&](int assign, int twice = 0, int twiceAssign = 0) {
+            if (twice && next == begin[0])
+            {
+                if (twiceAssign && rest >= 3 && begin[2] == '=')
+                    return Match(twiceAssign, begin + 3);
+                return Match(twice, begin + 2);
+            }
+            if (assign && next == '=')
+                return Match(assign, begin + 2);
+            return Match(static_cast<unsigned char>(begin[0]), begin + 1);
+        };
+
+        char c = begin[0];
+        if (IsIdentifierStart(c))
+        {
+            auto end = SkipIdentifier(begin + 1, _End);
+            return Match(Keyword(std::string_view(begin, end - begin)), end);
+        }
+        if (IsDigit(c) || (c == '.' && IsDigit(next)))
+            return Number(begin);
+        switch (c)
+        {
+        case '/':
+            if (next == '*')
+            {
+                auto end = FindCommentEnd(begin + 2, _End);
+                if (end == _End)
+                {
+                    // The flexc++ scanner repeats this warning forever
+                    Advance(_End);
+                    ErrorHandler::PrintWarning("Unterminated comment", ErrorHandler::Location(_Row, _Column, _Column));
+                    continue;
+                }
+                Advance(end + 2);
+                continue;
+            }
+            if (next == '/')
+            {
+                // Without a newline the slashes are operators
+                auto newline = FindNewline(begin + 2, _End);
+                if (newline != _End)
+                {
+                    _Current = newline + 1;
+                    ++_Row;
+                    _Column = 1;
+                    continue;
+                }
+            }
+            return op(Parser::DIV_ASSIGN);
+        case '\'':
+            if (rest >= 3 && next != '\n' && begin[2] == '\'')
+                return Match(Parser::CONSTCHAR, begin + 3);
+            Unknown();
+            continue;
+        case '<':
+            if (next == '=')
+                return Match(Parser::LE, begin + 2);
+            return op(0, Parser::SHL, Parser::SHL_ASSIGN);
+        case '>':
+            if (next == '=')
+                return Match(Parser::GE, begin + 2);
+            return op(0, Parser::SHR, Parser::SHR_ASSIGN);
+        case '=':
+            return op(Parser::EQ);
+        case '!':
+            return op(Parser::NE);
+        case '+':
+            return op(Parser::ADD_ASSIGN, Parser::INC);
+        case '-':
+            return op(Parser::SUB_ASSIGN, Parser::DEC);
+        case '*':
+            return op(Parser::MUL_ASSIGN);
+        case '%':
+            return op(Parser::MOD_ASSIGN);
+        case '&':
+            return op(Parser::AND_ASSIGN);
+        case '|':
+            return op(Parser::OR_ASSIGN);
+        case '^':
+            return op(Parser::XOR_ASSIGN);
+        case '(':
+        case ')':
+        case '[':
+        case ']':
+        case '{':
+        case '}':
+        case ',':
+        case ';':
+        case '~':
+            return op(0);
+        default:
+            Unknown();
+            continue;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string_view>
+#include "../ErrorHandler.hpp"
+
+// Hand-written scanner of the rules in Scanner.l, which returns the same tokens, lexemes,
+// locations and warnings as the flexc++ Scanner. It works on a contiguous buffer, and skips
+// whitespace and comments and finds the end of identifiers and numbers a vector at a time,
+// with AVX2 if the compiler targets it and SSE2 otherwise
+class Lexer
+{
+private:
+    const char *_Current, *_End;
+    // Position of _Current
+    unsigned int _Row = 1, _Column = 1;
+    std::string_view _Matched;
+    ErrorHandler::Location _Location;
+
+    // Moves _Current forward to `to`, counting the rows and columns in between
+    void Advance(const char *to);
+    int Match(int kind, const char *end);
+    void Unknown();
+    int Number(const char *begin);
+
+public:
+    // The source must outlive the lexer and its lexemes
+    inline explicit Lexer(std::string_view source) : _Current(source.data()), _End(source.data() + source.size()) {}
+
+    // Returns the kind of the next token, 0 at the end of the source
+    int Lex();
+
+    // Text of the last token, which points into the source
+    inline std::string_view GetMatched() const { return _Matched; }
+    inline ErrorHandler::Location GetLocation() const { return _Location; }
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
+#include "../ErrorHandler.hpp"
+
+// The text of a source file in one buffer. Regular files are mapped into memory, anything else
+// such as a pipe is read whole. The lexemes of the tokens and the names in the AST point into
+// the buffer, so it must outlive both
+class SourceBuffer
+{
+private:
+    void *_Mapped = nullptr;
+    size_t _MappedSize = 0;
+    std::string _Read;
+
+public:
+    inline SourceBuffer() = default;
+    inline ~SourceBuffer()
+    {
+        if (_Mapped)
+            munmap(_Mapped, _MappedSize);
+    }
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+    // Returns false after printing the reason to ErrorHandler::Stream()
+    inline bool Open(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            ErrorHandler::Stream() << "Error: Cannot open '" << path << "'\n";
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        {
+            auto mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED)
+            {
+                _Mapped = mapped;
+                _MappedSize = info.st_size;
+                close(fd);
+                return true;
+            }
+        }
+        // Pipes, terminals, empty files and files that cannot be mapped
+        char chunk[65536];
+        ssize_t count;
+        while ((count = read(fd, chunk, sizeof(chunk))) > 0)
+            _Read.append(chunk, count);
+        close(fd);
+        if (count < 0)
+        {
+            ErrorHandler::Stream() << "Error: Cannot read '" << path << "'\n";
+            return false;
+        }
+        return true;
+    }
+
+    inline std::string_view GetText() const
+    {
+        if (_Mapped)
+            return std::string_view(static_cast<const char *>(_Mapped), _MappedSize);
+        return _Read;
+    }
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include "Lexer.hpp"
+#include "../ErrorHandler.hpp"
+
+// Scans the whole input once and records every token, so that the .lex dump
+// and the parser can share the same token stream. The lexemes point into the source
+class TokenTape
+{
+public:
+    struct Token
+    {
+        int Kind;
+        std::string_view Matched;
+        ErrorHandler::Location Location;
+        inline explicit Token(int kind, std::string_view matched, const ErrorHandler::Location &loc)
+            : Kind(kind), Matched(matched), Location(loc) {}
+    };
+
+private:
+    std::vector<Token> _Tokens;
+    // Index of the token most recently returned by lex()
+    size_t _Current = 0;
+    bool _Started = false;
+
+public:
+    // The source must outlive the tape and the AST parsed from it
+    inline explicit TokenTape(std::string_view source)
+    {
+        Lexer lexer(source);
+        while (true)
+        {
+            auto tok = lexer.Lex();
+            // The end of file token is recorded as well,
+            // so that the parser can report errors at it
+            _Tokens.emplace_back(tok, lexer.GetMatched(), lexer.GetLocation());
+            if (tok == 0)
+                break;
+        }
+    }
+
+    // Tokens in source order, followed by the end of file token
+    inline const std::vector<Token> &GetTokens() const { return _Tokens; }
+
+    // Scanner-like interface used by the parser
+    inline int lex()
+    {
+        if (_Started && _Current + 1 < _Tokens.size())
+            ++_Current;
+        _Started = true;
+        return _Tokens[_Current].Kind;
+    }
+    inline std::string_view matched() const { return _Tokens[_Current].Matched; }
+    inline ErrorHandler::Location GetLocation() const { return _Tokens[_Current].Location; }
+};
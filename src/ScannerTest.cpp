@@ -0,0 +1,188 @@
+#include <glob.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Scanner/Scanner.ih"
+#include "Scanner/Lexer.hpp"
+
+// Differential test of the hand-written Lexer against the flexc++ Scanner generated from the
+// same rules: both scan the test programs and random inputs, and must return the same tokens,
+// lexemes and locations and print the same warnings
+
+// One line per token, followed by the warnings
+template <typename Next>
+static std::string Record(Next next)
+{
+    std::ostringstream tokens, warnings;
+    {
+        ErrorHandler::Redirect redirect(warnings);
+        while (true)
+        {
+            auto [kind, matched, loc] = next();
+            tokens << kind << ' ' << loc.Row << ':' << loc.ColStart << '-' << loc.ColEnd << ' ' << matched << '\n';
+            if (kind == 0)
+                break;
+        }
+    }
+    return tokens.str() + warnings.str();
+}
+
+static std::string ScanOld(const std::string &source)
+{
+    std::istringstream input(source);
+    std::ostringstream discarded;
+    Scanner s(input, discarded);
+    return Record([&]() {
+        auto kind = s.lex();
+        return std::make_tuple(kind, s.matched(), s.GetLocation());
+    });
+}
+
+static std::string ScanNew(const std::string &source)
+{
+    Lexer lexer(source);
+    return Record([&]() {
+        auto kind = lexer.Lex();
+        return std::make_tuple(kind, std::string(lexer.GetMatched()), lexer.GetLocation());
+    });
+}
+
+// Random text made of pieces of tokens, so that the rules meet each other at every boundary
+class RandomSource
+{
+private:
+    uint32_t _State;
+
+    inline unsigned long Random(unsigned long n)
+    {
+        _State = _State * 1103515245 + 12345;
+        return (_State >> 8) % n;
+    }
+
+public:
+    inline explicit RandomSource(uint32_t seed) : _State(seed) {}
+
+    inline std::string Next()
+    {
+        static const std::string pieces[] = {
+            "int", "integer", "if", "else", "while", "for", "return", "void", "_x1", "Ab_9", "e", "x", "b", "E",
+            "0", "1", "7", "8", "017", "019", "0x", "0X1f", "0b", "0B101", "0b2", "12", ".", "..", "1.", ".5", "e+",
+            "e-3", "'", "'a'", "''", "'''", "/", "*", "/*", "*/", "//", "+", "-", "<", ">", "=", "!", "&", "|",
+            "^", "%", "~", "(", ")", "[", "]", "{", "}", ",", ";", "#", "\"", "\\", "?", ":", "@", "$", "`",
+            " ", "  ", "\t", "\n", "\n\n", "\r", "\r\n", "\v", "\f", std::string(1, '\0'), "\x80",
+            "\xe4\xbd\xa0", "\xff", "                                        ",
+            "/* a comment\n spanning * lines / and ** stars */", "// a line comment\n",
+            "identifier_that_is_longer_than_one_vector_of_bytes", "12345678901234567890123456789012345"};
+        const unsigned long count = sizeof(pieces) / sizeof(pieces[0]);
+        std::string text;
+        for (auto n = Random(60); n > 0; --n)
+        {
+            const auto &piece = pieces[Random(count)];
+            // The flexc++ scanner drops a non-ASCII byte after a quote, which the Lexer reports
+            if (!text.empty() && text.back() == '\'' && static_cast<unsigned char>(piece[0]) >= 0x80)
+                text += ' ';
+            text += piece;
+        }
+        // It also never stops at an unterminated comment, so every comment is closed
+        return text + "\n*/";
+    }
+};
+
+// Paths matching the pattern, in sorted order
+static std::vector<std::string> Glob(const std::string &pattern)
+{
+    std::vector<std::string> paths;
+    glob_t matches;
+    if (glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+        paths.assign(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+    globfree(&matches);
+    return paths;
+}
+
+static bool Compare(const std::string &name, const std::string &source)
+{
+    auto expected = ScanOld(source), actual = ScanNew(source);
+    if (expected == actual)
+        return true;
+    std::istringstream e(expected), a(actual);
+    std::string el, al;
+    while (std::getline(e, el) && std::getline(a, al) && el == al)
+        ;
+    std::cout << "FAIL " << name << "\n  Scanner: " << el << "\n  Lexer:   " << al << '\n';
+    return false;
+}
+
+void ShowHelp(const char *name)
+{
+    std::cerr << "Usage: " << name << " [options] [file]...\n";
+    std::cerr << "  Compare the tokens of the Lexer with the ones of the flexc++ Scanner on the files,\n";
+    std::cerr << "  tests/*/*/test.cc by default, and on random inputs\n";
+    std::cerr << "Options: \n";
+    std::cerr << "  -random <n>  number of random inputs, default 100000\n";
+    std::cerr << "  -seed <n>    seed of the random inputs, default 1\n";
+}
+
+int main(int argc, const char *argv[])
+{
+    std::vector<std::string> paths;
+    unsigned long randomInputs = 100000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "-random" && i + 1 < argc)
+            randomInputs = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "-seed" && i + 1 < argc)
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg[0] == '-')
+        {
+            ShowHelp(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+        else
+            paths.push_back(arg);
+    }
+    if (paths.empty())
+        paths = Glob("tests/*/*/test.cc");
+
+    unsigned long failed = 0;
+    for (const auto &path : paths)
+    {
+        std::ifstream input(path, std::ios::binary);
+        if (!input)
+        {
+            std::cerr << "Error: Cannot open '" << path << "'\n";
+            return 1;
+        }
+        std::string source(std::istreambuf_iterator<char>(input), {});
+        failed += !Compare(path, source);
+    }
+    RandomSource random(seed);
+    for (unsigned long i = 0; i < randomInputs; ++i)
+    {
+        auto source = random.Next();
+        if (!Compare("random input " + std::to_string(i), source))
+        {
+            ++failed;
+            // Escaped, so that the input can be copied into a test
+            std::cout << "  input: \"";
+            for (unsigned char c : source)
+                if (c == '"' || c == '\\')
+                    std::cout << '\\' << c;
+                else if (c >= 32 && c < 127)
+                    std::cout << c;
+                else
+                    std::cout << "\\x" << std::hex << static_cast<int>(c) << std::dec << "\"\"";
+            std::cout << "\"\n";
+        }
+    }
+    std::cout << paths.size() + randomInputs - failed << " inputs passed, " << failed << " failed\n";
+    return failed > 0 ? 1 : 0;
+}
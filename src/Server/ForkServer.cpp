@@ -0,0 +1,135 @@
+#include "ForkServer.hpp"
+
+#include <llvm/Support/CommandLine.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "../Compiler.hpp"
+#include "../Backend/Target.hpp"
+
+namespace server
+{
+    // Prints an error and returns false if an option of the request was already given to the
+    // server. The children inherit the parsed options of the server, and LLVM rejects most of
+    // them when they occur twice
+    static bool CheckLLVMArgs(const std::vector<std::string> &args)
+    {
+        auto &registered = llvm::cl::getRegisteredOptions();
+        for (const auto &arg : args)
+        {
+            auto begin = arg.find_first_not_of('-');
+            if (begin == 0 || begin == std::string::npos)
+                continue;
+            auto name = arg.substr(begin, arg.find('=') - begin);
+            auto option = registered.find(name);
+            if (option != registered.end() && option->second->getNumOccurrences() > 0)
+            {
+                std::cerr << "Error: '-mllvm " << arg << "' was already given to the fork server\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Parses a request in the server, returns false and prints the reason if it is invalid
+    static bool ParseRequest(const std::string &line, Options &opts)
+    {
+        std::istringstream ss(line);
+        std::vector<std::string> args{"exe"};
+        for (std::string arg; ss >> arg;)
+            args.push_back(arg);
+        std::vector<const char *> argv;
+        for (const auto &arg : args)
+            argv.push_back(arg.c_str());
+        if (!opts.Parse(argv.size(), argv.data()))
+            return false;
+        if (opts.Run || !opts.Serve.empty() || opts.ForkServer)
+        {
+            std::cerr << "Error: '--run', '--serve' and '--fork-server' are not supported by the fork server\n";
+            return false;
+        }
+        return CheckLLVMArgs(opts.LLVMArgs);
+    }
+
+    int ForkServer::Serve(std::istream &requests, std::ostream &replies, const CompileFunction &compile)
+    {
+        // Pay for the target initialization and the lazily built pass registries once,
+        // by compiling a small program before the first fork
+        backend::Target::InitializeNative();
+        Options warmUp;
+        warmUp.OptLevel = 2;
+        warmUp.EmitObj = true;
+        Compiler::Compile("void main(void)\n{\n}\n", warmUp);
+
+        std::string line;
+        while (std::getline(requests, line))
+        {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            Options opts;
+            if (!ParseRequest(line, opts))
+            {
+                std::cerr.flush();
+                replies << 1 << std::endl;
+                continue;
+            }
+            // Buffered output would otherwise be written twice
+            replies.flush();
+            std::cerr.flush();
+            auto pid = fork();
+            if (pid < 0)
+            {
+                std::cerr << "Error: Cannot fork: " << std::strerror(errno) << '\n';
+                replies << "signal 0" << std::endl;
+                continue;
+            }
+            if (pid == 0)
+                RunChild(opts, compile);
+
+            int status = 0;
+            int result;
+            while ((result = waitpid(pid, &status, 0)) < 0 && errno == EINTR)
+                ;
+            if (result < 0)
+            {
+                std::cerr << "Error: Cannot wait for the compilation: " << std::strerror(errno) << '\n';
+                replies << "signal 0" << std::endl;
+            }
+            else if (WIFEXITED(status))
+                replies << WEXITSTATUS(status) << std::endl;
+            else
+                replies << "signal " << WTERMSIG(status) << std::endl;
+        }
+        return 0;
+    }
+
+    void ForkServer::RunChild(const Options &opts, const CompileFunction &compile)
+    {
+        // The control pipe belongs to the server, a child must neither read
+        // requests nor write replies
+        auto devNull = open("/dev/null", O_RDONLY);
+        dup2(devNull, STDIN_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+
+        // Only this child sees the options
+        if (!opts.LLVMArgs.empty())
+        {
+            std::vector<const char *> llvmArgs{"exe"};
+            for (const auto &arg : opts.LLVMArgs)
+                llvmArgs.push_back(arg.c_str());
+            llvm::cl::ParseCommandLineOptions(llvmArgs.size(), llvmArgs.data());
+        }
+        auto status = compile(opts);
+        // Skip the destructors of the server's LLVM state, the outputs are already closed
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(status);
+    }
+} // namespace server
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <ostream>
+#include "../Options.hpp"
+
+namespace server
+{
+    // Initializes LLVM once, then forks a child per request, so that every compilation
+    // starts from a warm copy-on-write image and a crash only takes the child down.
+    // A request is a line of build/exe arguments separated by whitespace, e.g. "-O2 -c a.cc".
+    // The reply is a line with the exit status of the child, or "signal <n>" if it crashed
+    class ForkServer
+    {
+    public:
+        // Compiles the parsed options of a request in the child, returning its exit status
+        using CompileFunction = std::function<int(const Options &)>;
+
+        // Serves requests until `requests` ends, returns the exit status of the server
+        static int Serve(std::istream &requests, std::ostream &replies, const CompileFunction &compile);
+
+    private:
+        // Runs in the child and never returns
+        [[noreturn]] static void RunChild(const Options &opts, const CompileFunction &compile);
+    };
+} // namespace server
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Messages between the compile server and its clients over a Unix domain socket.
+// Every string is sent as a 32-bit length followed by its bytes.
+//   Request:  argument count, arguments as given to build/exe, source, one per connection
+//   Response: exit status, diagnostics, IR, bitcode, assembly, object
+namespace server
+{
+    inline bool WriteAll(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            auto n = write(fd, data, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    inline bool ReadAll(int fd, char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            auto n = read(fd, data, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    inline bool WriteU32(int fd, uint32_t value) { return WriteAll(fd, reinterpret_cast<const char *>(&value), 4); }
+    inline bool ReadU32(int fd, uint32_t &value) { return ReadAll(fd, reinterpret_cast<char *>(&value), 4); }
+
+    inline bool WriteString(int fd, std::string_view str)
+    {
+        return WriteU32(fd, str.size()) && WriteAll(fd, str.data(), str.size());
+    }
+
+    // Fails on strings longer than `limit`, before allocating them
+    inline bool ReadString(int fd, std::string &str, uint32_t limit = UINT32_MAX)
+    {
+        uint32_t size;
+        if (!ReadU32(fd, size) || size > limit)
+            return false;
+        str.resize(size);
+        return ReadAll(fd, str.data(), size);
+    }
+
+    struct Request
+    {
+        // Limits of a request, so that a malformed one cannot make the server allocate gigabytes
+        static constexpr uint32_t MaxArgs = 1024, MaxArgSize = 4096, MaxSourceSize = 256 << 20;
+
+        std::vector<std::string> Args;
+        std::string Source;
+
+        inline bool Write(int fd) const
+        {
+            if (!WriteU32(fd, Args.size()))
+                return false;
+            for (const auto &arg : Args)
+                if (!WriteString(fd, arg))
+                    return false;
+            return WriteString(fd, Source);
+        }
+
+        inline bool Read(int fd)
+        {
+            uint32_t count;
+            if (!ReadU32(fd, count) || count > MaxArgs)
+                return false;
+            Args.resize(count);
+            for (auto &arg : Args)
+                if (!ReadString(fd, arg, MaxArgSize))
+                    return false;
+            return ReadString(fd, Source, MaxSourceSize);
+        }
+    };
+
+    struct Response
+    {
+        uint32_t Status = 1;
+        std::string Diagnostics, IR, Bitcode, Assembly, Object;
+
+        inline bool Write(int fd) const
+        {
+            return WriteU32(fd, Status) && WriteString(fd, Diagnostics) && WriteString(fd, IR) &&
+                   WriteString(fd, Bitcode) && WriteString(fd, Assembly) && WriteString(fd, Object);
+        }
+
+        inline bool Read(int fd)
+        {
+            return ReadU32(fd, Status) && ReadString(fd, Diagnostics) && ReadString(fd, IR) &&
+                   ReadString(fd, Bitcode) && ReadString(fd, Assembly) && ReadString(fd, Object);
+        }
+    };
+
+    // Returns false if `path` does not fit into a socket address
+    inline bool MakeAddress(const std::string &path, sockaddr_un &addr)
+    {
+        addr = sockaddr_un();
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path))
+            return false;
+        path.copy(addr.sun_path, path.size());
+        return true;
+    }
+} // namespace server
@@ -0,0 +1,227 @@
+#include "Server.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../Compiler.hpp"
+#include "../ErrorHandler.hpp"
+#include "../Backend/Target.hpp"
+
+namespace server
+{
+    Server::~Server()
+    {
+        if (_Socket >= 0)
+            close(_Socket);
+        // Not if the path was replaced in the meantime
+        struct stat info;
+        if (_Bound && lstat(_Path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode) && info.st_dev == _Device &&
+            info.st_ino == _Inode)
+            unlink(_Path.c_str());
+    }
+
+    bool Server::Listen()
+    {
+        sockaddr_un addr;
+        if (!MakeAddress(_Path, addr))
+        {
+            std::cerr << "Error: Socket path '" << _Path << "' is too long\n";
+            return false;
+        }
+        struct stat info;
+        if (lstat(_Path.c_str(), &info) == 0)
+        {
+            if (!S_ISSOCK(info.st_mode))
+            {
+                std::cerr << "Error: '" << _Path << "' exists and is not a socket\n";
+                return false;
+            }
+            // Only a socket that nobody listens on any more is stale
+            auto probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            auto live = probe >= 0 && connect(probe, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+            if (probe >= 0)
+                close(probe);
+            if (live)
+            {
+                std::cerr << "Error: A server is already listening on '" << _Path << "'\n";
+                return false;
+            }
+            unlink(_Path.c_str());
+        }
+        _Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_Socket < 0 || bind(_Socket, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            std::cerr << "Error: Cannot listen on '" << _Path << "': " << std::strerror(errno) << '\n';
+            return false;
+        }
+        _Bound = lstat(_Path.c_str(), &info) == 0;
+        _Device = info.st_dev;
+        _Inode = info.st_ino;
+        if (listen(_Socket, SOMAXCONN) < 0)
+        {
+            std::cerr << "Error: Cannot listen on '" << _Path << "': " << std::strerror(errno) << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    void Server::Serve()
+    {
+        // A client that disconnects early must not kill the server
+        std::signal(SIGPIPE, SIG_IGN);
+        // Pay for the target initialization once, not in the first requests
+        backend::Target::InitializeNative();
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < _Jobs; ++i)
+            workers.emplace_back(&Server::Work, this);
+        std::cerr << "Listening on " << _Path << " with " << _Jobs << " workers\n";
+        // Connections are only handed to a worker once their request arrives,
+        // so that idle clients do not hold on to the workers
+        struct Waiting
+        {
+            int Fd;
+            std::chrono::steady_clock::time_point Deadline;
+        };
+        std::vector<Waiting> waiting;
+        std::vector<pollfd> polled;
+        while (true)
+        {
+            polled.assign(1, pollfd{_Socket, POLLIN, 0});
+            for (const auto &w : waiting)
+                polled.push_back(pollfd{w.Fd, POLLIN, 0});
+            if (poll(polled.data(), polled.size(), 1000) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << "Error: Cannot wait for connections: " << std::strerror(errno) << '\n';
+                break;
+            }
+            auto now = std::chrono::steady_clock::now();
+            // Readable also means closed, which the worker finds out
+            for (size_t i = waiting.size(); i-- > 0;)
+            {
+                auto fd = waiting[i].Fd;
+                if (polled[i + 1].revents != 0)
+                {
+                    std::lock_guard<std::mutex> lock(_Mutex);
+                    _Connections.push_back(fd);
+                    _Ready.notify_one();
+                }
+                else if (now > waiting[i].Deadline)
+                    close(fd);
+                else
+                    continue;
+                waiting[i] = waiting.back();
+                waiting.pop_back();
+            }
+            if (!(polled[0].revents & POLLIN))
+                continue;
+            auto fd = accept(_Socket, nullptr, nullptr);
+            if (fd >= 0)
+                waiting.push_back({fd, now + std::chrono::seconds(RequestTimeoutSeconds)});
+            else if (errno != EINTR && errno != ECONNABORTED)
+            {
+                std::cerr << "Error: Cannot accept connections: " << std::strerror(errno) << '\n';
+                break;
+            }
+        }
+        // Workers never return, the process exits with them
+        for (auto &w : workers)
+            w.detach();
+    }
+
+    void Server::Work()
+    {
+        while (true)
+        {
+            int fd;
+            {
+                std::unique_lock<std::mutex> lock(_Mutex);
+                _Ready.wait(lock, [this] { return !_Connections.empty(); });
+                fd = _Connections.front();
+                _Connections.pop_front();
+            }
+            // A failed request must not take the other compilations of the process down with it
+            try
+            {
+                Handle(fd);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Error: Request failed: " << e.what() << '\n';
+            }
+            close(fd);
+        }
+    }
+
+    void Server::Handle(int fd)
+    {
+        // A client that stops in the middle of its request or response gives up its worker
+        timeval timeout{RequestTimeoutSeconds, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        Request request;
+        if (request.Read(fd))
+            Compile(request).Write(fd);
+    }
+
+    Response Server::Compile(const Request &request)
+    {
+        Response response;
+        Options opts;
+        {
+            // Options report errors through the diagnostics of the request
+            std::ostringstream diagnostics;
+            ErrorHandler::Redirect redirect(diagnostics);
+            std::vector<const char *> argv{"exe"};
+            for (const auto &arg : request.Args)
+                argv.push_back(arg.c_str());
+            auto valid = opts.Parse(argv.size(), argv.data());
+            // These are global to the process, need the terminal or write files of their own,
+            // so the server would not do what the command line does
+            std::pair<bool, const char *> unsupported[] = {
+                {opts.Run, "--run"},
+                {opts.EmitTokens, "-emit-tokens"},
+                {opts.EmitAST, "-emit-ast"},
+                {opts.TimeTrace, "-ftime-trace"},
+                {!opts.LLVMArgs.empty(), "-mllvm"},
+                {opts.Incremental, "-incremental"},
+                {opts.CacheStats, "-cache-stats"},
+                {!opts.CacheDir.empty(), "-cache-dir"},
+                {opts.TimePhases, "-time-phases"},
+                {!opts.TimePhasesJSON.empty(), "-time-phases-json"},
+                {opts.MemReport, "-mem-report"},
+                {opts.HardwareCounters, "-perf-counters"},
+                {!opts.Serve.empty(), "--serve"},
+                {opts.ForkServer, "--fork-server"},
+            };
+            for (const auto &[given, name] : unsupported)
+                if (valid && given)
+                {
+                    ErrorHandler::Stream() << "Error: '" << name << "' is not supported by the server\n";
+                    valid = false;
+                }
+            if (!valid)
+            {
+                response.Diagnostics = diagnostics.str();
+                return response;
+            }
+        }
+        auto result = Compiler::Compile(request.Source, opts);
+        response.Status = result.Success ? 0 : 1;
+        response.Diagnostics = std::move(result.Diagnostics);
+        response.IR = std::move(result.IR);
+        response.Bitcode = std::move(result.Bitcode);
+        response.Assembly = std::move(result.Assembly);
+        response.Object = std::move(result.Object);
+        return response;
+    }
+} // namespace server
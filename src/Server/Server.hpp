@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "Protocol.hpp"
+
+namespace server
+{
+    // Keeps LLVM initialized and compiles the requests of clients on a pool of worker threads.
+    // Each connection sends one request, so that idle clients do not hold on to a worker
+    class Server
+    {
+    private:
+        std::string _Path;
+        unsigned int _Jobs;
+        int _Socket = -1;
+        // The socket file bound by this process, which is the only one removed at exit
+        bool _Bound = false;
+        dev_t _Device = 0;
+        ino_t _Inode = 0;
+        // Accepted connections waiting for a worker
+        std::deque<int> _Connections;
+        std::mutex _Mutex;
+        std::condition_variable _Ready;
+
+        // Time a client may stall while it sends its request or receives the response
+        static constexpr long RequestTimeoutSeconds = 30;
+
+        void Work();
+        void Handle(int fd);
+        static Response Compile(const Request &request);
+
+    public:
+        inline explicit Server(const std::string &path, unsigned int jobs) : _Path(path), _Jobs(jobs) {}
+        ~Server();
+        Server(const Server &) = delete;
+        Server &operator=(const Server &) = delete;
+
+        // Binds the socket, replacing a stale socket left at the path. Any other file at the
+        // path, or a socket that a server still listens on, is an error.
+        // Returns false after printing the reason
+        bool Listen();
+
+        // Accepts connections until the process is stopped
+        void Serve();
+    };
+} // namespace server
@@ -53,6 +53,21 @@ namespace ast
 
     public:
         inline SymbolTable *GetParent() { return _Parent; }
+        // Sizes of this scope and all scopes nested in it
+        inline size_t CountScopes() const
+        {
+            size_t count = 1;
+            for (const auto &child : _Children)
+                count += child->CountScopes();
+            return count;
+        }
+        inline size_t CountSymbols() const
+        {
+            auto count = _SymbolList.size();
+            for (const auto &child : _Children)
+                count += child->CountSymbols();
+            return count;
+        }
         inline SymbolTable *AddChild()
         {
             _Children.push_back(std::make_unique<SymbolTable>());
@@ -0,0 +1,502 @@
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/TargetSelect.h>
+#include "Compiler.hpp"
+#include "Cache.hpp"
+#include "Incremental.hpp"
+#include "Scanner/TokenTape.hpp"
+#include "Parser/Parser.ih"
+#include "Backend/JIT.hpp"
+
+// Runs the golden tests in-process: every test is compiled through the library on a pool of
+// threads, its dumps are compared with the goldens next to it, and the program runs with the
+// JIT, in a child process forked by the same thread, with getchar and putchar bound to strings
+// instead of the terminal.
+// It is compiled and run again at -O2 and with -S -c to check the optimization pipelines and
+// that emitting native code leaves the module intact, and twice with -incremental to check
+// that unchanged functions are reused
+
+namespace
+{
+    // Input and output of the program running on this thread
+    struct Console
+    {
+        std::string Input;
+        size_t Next = 0;
+        std::string Output;
+    };
+
+    thread_local Console *CurrentConsole = nullptr;
+
+    extern "C" int CaptureGetchar()
+    {
+        auto console = CurrentConsole;
+        return console->Next < console->Input.size() ? static_cast<unsigned char>(console->Input[console->Next++])
+                                                     : EOF;
+    }
+
+    extern "C" int CapturePutchar(int ch)
+    {
+        CurrentConsole->Output.push_back(static_cast<char>(ch));
+        return ch;
+    }
+
+    struct TestResult
+    {
+        std::string Path;
+        bool Passed = true;
+        // Why the test failed, or the goldens that were written
+        std::string Report;
+    };
+} // namespace
+
+static bool ReadFile(const std::string &path, std::string &content)
+{
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+        return false;
+    std::ostringstream ss;
+    ss << input.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+// The first line that differs, as "line <n>: expected '...', got '...'"
+static std::string FirstDifference(const std::string &expected, const std::string &actual)
+{
+    std::istringstream e(expected), a(actual);
+    std::string el, al;
+    for (unsigned int row = 1;; ++row)
+    {
+        bool eMore = static_cast<bool>(std::getline(e, el)), aMore = static_cast<bool>(std::getline(a, al));
+        if (!eMore && !aMore)
+            return "the end of line differs";
+        if (!eMore || !aMore || el != al)
+            return "line " + std::to_string(row) + ": expected '" + (eMore ? el : "<end>") + "', got '" +
+                   (aMore ? al : "<end>") + "'";
+    }
+}
+
+// Compares `actual` with the golden `path + ext`, or writes the golden with `update`.
+// A missing golden fails the test unless it is written
+static void Check(TestResult &result, const std::string &ext, const std::string &actual, bool update)
+{
+    auto golden = result.Path + ext;
+    std::string expected;
+    bool exists = ReadFile(golden, expected);
+    if (update)
+    {
+        if (exists && expected == actual)
+            return;
+        std::ofstream output(golden, std::ios::binary);
+        output << actual;
+        result.Report += "  wrote " + golden + '\n';
+    }
+    else if (!exists)
+    {
+        result.Passed = false;
+        result.Report += "  " + golden + " is missing, write it with -update\n";
+    }
+    else if (expected != actual)
+    {
+        result.Passed = false;
+        result.Report += "  " + golden + " differs at " + FirstDifference(expected, actual) + '\n';
+    }
+}
+
+// Seconds a program may run before it is killed, set with -timeout
+static unsigned int Timeout = 10;
+
+// Calls `main` in a child process, so that a program that crashes or does not stop only fails
+// its own test. The module is compiled by the caller, the child only runs the generated code
+// and exits with the result of `main`. Returns what it printed, or nullopt after setting
+// `failure` to the reason, which includes a result other than 0
+static std::optional<std::string> CallIsolated(int (*entry)(), std::string &failure)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        failure = std::string("cannot create a pipe: ") + std::strerror(errno);
+        return std::nullopt;
+    }
+    auto pid = fork();
+    if (pid == 0)
+    {
+        // The console of this thread was copied with the process
+        close(fds[0]);
+        auto status = entry();
+        const auto &output = CurrentConsole->Output;
+        for (size_t written = 0; written < output.size();)
+        {
+            auto n = write(fds[1], output.data() + written, output.size() - written);
+            // The exit status belongs to the program
+            if (n <= 0)
+                abort();
+            written += n;
+        }
+        _exit(status);
+    }
+    close(fds[1]);
+    if (pid < 0)
+    {
+        close(fds[0]);
+        failure = std::string("cannot fork: ") + std::strerror(errno);
+        return std::nullopt;
+    }
+    // Children forked by other threads may hold the write end as well, so the end of the
+    // output is the exit of the child rather than the end of the pipe
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(Timeout);
+    std::string output;
+    int status = 0;
+    bool exited = false, timedOut = false;
+    while (true)
+    {
+        char chunk[4096];
+        ssize_t n;
+        while ((n = read(fds[0], chunk, sizeof(chunk))) > 0)
+            output.append(chunk, n);
+        if (exited)
+            break;
+        if (waitpid(pid, &status, WNOHANG) == pid)
+            // Read once more what was written right before the exit
+            exited = true;
+        else if (std::chrono::steady_clock::now() > deadline)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            timedOut = true;
+            break;
+        }
+        else
+        {
+            pollfd readable{fds[0], POLLIN, 0};
+            poll(&readable, 1, 10);
+        }
+    }
+    close(fds[0]);
+    if (timedOut)
+        failure = "did not stop within " + std::to_string(Timeout) + " s";
+    else if (WIFSIGNALED(status))
+        failure = std::string("was killed by signal ") + strsignal(WTERMSIG(status));
+    else if (WEXITSTATUS(status) != 0)
+        failure = "returned " + std::to_string(WEXITSTATUS(status));
+    else
+        return output;
+    return std::nullopt;
+}
+
+// Runs the program with `input` on its stdin and returns its output,
+// nullopt after setting `failure` if it cannot be run
+static std::optional<std::string> RunProgram(Compiler::Result &compiled, const std::string &input,
+                                             std::string &failure)
+{
+    Console console;
+    console.Input = input;
+    CurrentConsole = &console;
+    std::optional<std::string> output;
+    auto status = backend::JIT::Run(std::move(compiled.Context), std::move(compiled.Module),
+                                    {{"getchar", reinterpret_cast<void *>(&CaptureGetchar)},
+                                     {"putchar", reinterpret_cast<void *>(&CapturePutchar)}},
+                                    [&](int (*entry)()) -> std::optional<int> {
+                                        output = CallIsolated(entry, failure);
+                                        return output ? 0 : 1;
+                                    });
+    CurrentConsole = nullptr;
+    if (!status)
+        failure = "could not be compiled by the JIT";
+    return status ? output : std::nullopt;
+}
+
+// Scalar locals left in memory, which the optimization pipelines promote to registers
+static size_t CountScalarAllocas(const llvm::Module &mod)
+{
+    size_t count = 0;
+    for (const auto &f : mod)
+        for (const auto &block : f)
+            for (const auto &inst : block)
+                if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst))
+                    count += !alloca->getAllocatedType()->isArrayTy();
+    return count;
+}
+
+// Compiles the test again with other options. Optimized modules must promote every scalar
+// local, and when the output is checked, every module must print the same output as the
+// unoptimized program, including after the assembly and object code are emitted from it
+static void CheckVariants(TestResult &result, const std::string &source, const std::string &input,
+                          const std::optional<std::string> &expected)
+{
+    struct Variant
+    {
+        const char *Name;
+        unsigned int OptLevel;
+        bool PerFunctionOpt, Emit;
+    };
+    for (const auto &variant : {Variant{"-O2", 2, false, false}, Variant{"-O2 -per-function-opt", 2, true, false},
+                                Variant{"-S -c", 0, false, true}, Variant{"-O2 -S -c", 2, false, true}})
+    {
+        std::string name = variant.Name;
+        Options opts;
+        opts.OptLevel = variant.OptLevel;
+        opts.PerFunctionOpt = variant.PerFunctionOpt;
+        opts.EmitAsm = opts.EmitObj = variant.Emit;
+        auto compiled = Compiler::Compile(source, opts);
+        if (!compiled.Success)
+        {
+            result.Passed = false;
+            result.Report += "  compilation with " + name + " failed:\n" + compiled.Diagnostics;
+            continue;
+        }
+        auto count = CountScalarAllocas(*compiled.Module);
+        if (opts.NeedOptimize() && count > 0)
+        {
+            result.Passed = false;
+            result.Report += "  " + name + " left " + std::to_string(count) + " scalar allocas\n";
+        }
+        if (!expected)
+            continue;
+        std::string failure;
+        auto output = RunProgram(compiled, input, failure);
+        if (!output)
+        {
+            result.Passed = false;
+            result.Report += "  the program compiled with " + name + ' ' + failure + '\n';
+        }
+        else if (*output != *expected)
+        {
+            result.Passed = false;
+            result.Report += "  the output with " + name + " differs at " + FirstDifference(*expected, *output) + '\n';
+        }
+    }
+}
+
+// Compiles the test with -O2 -incremental into an empty cache, and again with a line inserted
+// at the top. The second time, the code of every function must come from the cache, including
+// the functions that use globals, and the program must print the same output
+static void CheckIncremental(TestResult &result, const std::string &source, const std::string &input,
+                             const std::optional<std::string> &expected)
+{
+    llvm::SmallString<64> prefix, dir;
+    llvm::sys::path::system_temp_directory(true, prefix);
+    llvm::sys::path::append(prefix, "test-runner-cache");
+    if (llvm::sys::fs::createUniqueDirectory(prefix, dir))
+    {
+        result.Passed = false;
+        result.Report += "  cannot create a cache directory for -incremental\n";
+        return;
+    }
+    Options opts;
+    opts.OptLevel = 2;
+    opts.Incremental = opts.PerFunctionOpt = true;
+    opts.CacheDir = dir.str().str();
+    for (const auto &text : {source, '\n' + source})
+    {
+        Cache cache(opts.CacheDir, opts.CacheSizeMB << 20);
+        Compiler::Result compiled;
+        std::ostringstream diagnostics;
+        {
+            ErrorHandler::Redirect redirect(diagnostics);
+            TokenTape tokens(text);
+            Parser p(tokens);
+            compiled.Context = std::make_unique<llvm::LLVMContext>();
+            compiled.Module = std::make_unique<llvm::Module>("Module", *compiled.Context);
+            if (cache.Init() && p.parse() == 0)
+            {
+                auto astRoot = p.GetRoot();
+                compiled.Success = Incremental::BuildModule(tokens, *ast::cast<ast::DeclarationList>(astRoot),
+                                                            *compiled.Module, opts, nullptr, cache);
+            }
+        }
+        if (!compiled.Success)
+        {
+            result.Passed = false;
+            result.Report += "  compilation with -O2 -incremental failed:\n" + diagnostics.str();
+            break;
+        }
+        if (text != source && (cache.GetFunctionsRegenerated() > 0 || cache.GetFunctionsReused() == 0))
+        {
+            result.Passed = false;
+            result.Report += "  -incremental regenerated " + std::to_string(cache.GetFunctionsRegenerated()) +
+                             " unchanged functions and reused " + std::to_string(cache.GetFunctionsReused()) + '\n';
+        }
+        if (!expected)
+            continue;
+        std::string failure;
+        auto output = RunProgram(compiled, input, failure);
+        if (!output)
+        {
+            result.Passed = false;
+            result.Report += "  the program compiled with -O2 -incremental " + failure + '\n';
+        }
+        else if (*output != *expected)
+        {
+            result.Passed = false;
+            result.Report += "  the output with -O2 -incremental differs at " + FirstDifference(*expected, *output) + '\n';
+        }
+    }
+    llvm::sys::fs::remove_directories(dir);
+}
+
+static TestResult RunTest(const std::string &path, bool update)
+{
+    TestResult result;
+    result.Path = path;
+    std::string source;
+    if (!ReadFile(path, source))
+    {
+        result.Passed = false;
+        result.Report = "  cannot read the test\n";
+        return result;
+    }
+    Options opts;
+    opts.EmitTokens = opts.EmitAST = opts.EmitLLVM = true;
+    auto compiled = Compiler::Compile(source, opts);
+    Check(result, ".lex", compiled.Tokens, update);
+    Check(result, ".ast", compiled.AST, update);
+    if (!compiled.Success)
+    {
+        result.Passed = false;
+        result.Report += "  compilation failed:\n" + compiled.Diagnostics;
+        return result;
+    }
+    Check(result, ".ir", compiled.IR, update);
+
+    // The program reads <test>.in if there is one
+    std::string input, failure;
+    ReadFile(path + ".in", input);
+    auto output = RunProgram(compiled, input, failure);
+    if (!output)
+    {
+        result.Passed = false;
+        result.Report += "  the program " + failure + '\n';
+        return result;
+    }
+    // <test>.out.skip gives the reason why the output is not checked, e.g. uninitialized
+    // variables, whose values also change once optimized
+    std::string skipReason;
+    bool checkOutput = !ReadFile(path + ".out.skip", skipReason);
+    if (checkOutput)
+        Check(result, ".out", *output, update);
+    CheckVariants(result, source, input, checkOutput ? output : std::nullopt);
+    CheckIncremental(result, source, input, checkOutput ? output : std::nullopt);
+    return result;
+}
+
+// Paths matching the pattern, in sorted order
+static std::vector<std::string> Glob(const std::string &pattern)
+{
+    std::vector<std::string> paths;
+    glob_t matches;
+    if (glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+        paths.assign(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+    globfree(&matches);
+    return paths;
+}
+
+// Parses a whole decimal number from 1 to 100000
+static bool ParsePositive(const char *text, unsigned int &value)
+{
+    char *end = nullptr;
+    auto number = '0' <= text[0] && text[0] <= '9' ? std::strtoul(text, &end, 10) : 0;
+    if (!end || *end != '\0' || number < 1 || number > 100000)
+        return false;
+    value = number;
+    return true;
+}
+
+void ShowHelp(const char *name)
+{
+    std::cerr << "Usage: " << name << " [options] [test.cc]...\n";
+    std::cerr << "  Compile the tests, compare the tokens, AST and IR with the goldens next to them,\n";
+    std::cerr << "  run them with <test>.in as input and compare the output with <test>.out\n";
+    std::cerr << "  The default tests are tests/*/Test*/test.cc\n";
+    std::cerr << "Options: \n";
+    std::cerr << "  -j <n>     run <n> tests at a time, default one per hardware thread\n";
+    std::cerr << "  -update    write the goldens that differ or are missing instead of failing\n";
+    std::cerr << "  -timeout <s>\n";
+    std::cerr << "             kill the programs that run longer, default 10\n";
+}
+
+int main(int argc, const char *argv[])
+{
+    std::vector<std::string> paths;
+    unsigned int jobs = std::thread::hardware_concurrency();
+    bool update = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "-j" && i + 1 < argc && ParsePositive(argv[i + 1], jobs))
+            ++i;
+        else if (arg == "-update")
+            update = true;
+        else if (arg == "-timeout" && i + 1 < argc && ParsePositive(argv[i + 1], Timeout))
+            ++i;
+        else if (arg[0] == '-')
+        {
+            ShowHelp(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+        else
+            paths.push_back(arg);
+    }
+    if (paths.empty())
+        paths = Glob("tests/*/Test*/test.cc");
+    if (paths.empty())
+    {
+        std::cerr << "Error: No tests found\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    // Once up front, instead of concurrently by the first tests
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    std::vector<TestResult> results(paths.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < paths.size())
+            results[i] = RunTest(paths[i], update);
+    };
+    jobs = std::max(1u, std::min<unsigned int>(jobs, paths.size()));
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < jobs; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for (auto &w : workers)
+        w.join();
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0;
+    for (const auto &r : results)
+    {
+        if (!r.Passed)
+            ++failed;
+        if (!r.Passed || !r.Report.empty())
+            std::cout << (r.Passed ? "PASS " : "FAIL ") << r.Path << '\n' << r.Report;
+    }
+    std::cout << results.size() - failed << " passed, " << failed << " failed in " << seconds << " s\n";
+    return failed > 0 ? 1 : 0;
+}
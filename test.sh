@@ -1,10 +1,6 @@
 #!/bin/bash
 
-echo "Generating LLVM IR code..."          && \
-build/exe tests/$1/test.cc                 && \
+# Usage: ./test.sh <test> [options], e.g. ./test.sh Basic/Test1 -O2
 
-echo "Converting IR code to byte code..."  && \
-llvm-as tests/$1/test.cc.ir                && \
-
-echo "Running byte code..."                && \
-lli tests/$1/test.cc.ir.bc
+echo "Generating outputs and running the program..."
+build/exe -emit-tokens -emit-ast -emit-llvm -emit-bc --run "${@:2}" tests/$1/test.cc
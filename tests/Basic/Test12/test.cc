@@ -0,0 +1,33 @@
+int getchar();
+int putchar(int ch);
+
+int count = 0;
+int total;
+
+void output(int n)
+{
+    if (n >= 10)
+        output(n / 10);
+    putchar(n % 10 + '0');
+}
+
+void add(int n)
+{
+    count = count + 1;
+    total = total + n;
+}
+
+void main(void)
+{
+    int c = getchar();
+    while (c != -1)
+    {
+        if ('0' <= c & c <= '9')
+            add(c - '0');
+        c = getchar();
+    }
+    output(count);
+    putchar(' ');
+    output(total);
+    putchar(10);
+}
@@ -0,0 +1,39 @@
+int getchar();
+int putchar(int ch);
+
+void output(int n)
+{
+    if (n < 0)
+    {
+        putchar('-');
+        n = -n;
+    }
+    else if (n == 0)
+    {
+        putchar('0');
+        putchar(10);
+        return;
+    }
+    int num[20], idx = 0;
+    while (n != 0)
+    {
+        num[idx] = n % 10;
+        n /= 10;
+        ++idx;
+    }
+    for (--idx; idx >= 0; --idx)
+        putchar(num[idx] + '0');
+    putchar(10);
+}
+
+int fib(int n)
+{
+    if (n < 2)
+        return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+void main(void)
+{
+    output(fib(36));
+}
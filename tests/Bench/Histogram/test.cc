@@ -0,0 +1,54 @@
+int getchar();
+int putchar(int ch);
+
+void output(int n)
+{
+    if (n < 0)
+    {
+        putchar('-');
+        n = -n;
+    }
+    else if (n == 0)
+    {
+        putchar('0');
+        putchar(10);
+        return;
+    }
+    int num[20], idx = 0;
+    while (n != 0)
+    {
+        num[idx] = n % 10;
+        n /= 10;
+        ++idx;
+    }
+    for (--idx; idx >= 0; --idx)
+        putchar(num[idx] + '0');
+    putchar(10);
+}
+
+void histogram(int *bins, int count, int seed)
+{
+    int i, value;
+    for (i = 0; i < 256; ++i)
+        bins[i] = 0;
+    for (i = 0; i < count; ++i)
+    {
+        seed = (seed * 1103 + 12345) % 65536;
+        value = seed ^ (seed >> 5);
+        ++bins[value & 255];
+    }
+}
+
+void main(void)
+{
+    int bins[256], i, checksum = 0, max = 0;
+    histogram(bins, 50000000, 1);
+    for (i = 0; i < 256; ++i)
+    {
+        if (bins[i] > max)
+            max = bins[i];
+        checksum = (checksum * 31 + bins[i]) % 1000003;
+    }
+    output(max);
+    output(checksum);
+}
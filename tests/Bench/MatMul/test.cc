@@ -0,0 +1,58 @@
+int getchar();
+int putchar(int ch);
+
+void output(int n)
+{
+    if (n < 0)
+    {
+        putchar('-');
+        n = -n;
+    }
+    else if (n == 0)
+    {
+        putchar('0');
+        putchar(10);
+        return;
+    }
+    int num[20], idx = 0;
+    while (n != 0)
+    {
+        num[idx] = n % 10;
+        n /= 10;
+        ++idx;
+    }
+    for (--idx; idx >= 0; --idx)
+        putchar(num[idx] + '0');
+    putchar(10);
+}
+
+// c = a * b for n x n matrices stored by rows
+void multiply(int *a, int *b, int *c, int n)
+{
+    int i, j, k, sum;
+    for (i = 0; i < n; ++i)
+        for (j = 0; j < n; ++j)
+        {
+            sum = 0;
+            for (k = 0; k < n; ++k)
+                sum += a[i * n + k] * b[k * n + j];
+            c[i * n + j] = sum;
+        }
+}
+
+void main(void)
+{
+    int a[90000], b[90000], c[90000], i, seed = 1, checksum = 0;
+    for (i = 0; i < 90000; ++i)
+    {
+        seed = (seed * 1103 + 12345) % 65536;
+        a[i] = seed % 10;
+        seed = (seed * 1103 + 12345) % 65536;
+        b[i] = seed % 10;
+    }
+    for (i = 0; i < 10; ++i)
+        multiply(a, b, c, 300);
+    for (i = 0; i < 90000; ++i)
+        checksum = (checksum * 31 + c[i]) % 1000003;
+    output(checksum);
+}
@@ -0,0 +1,73 @@
+int getchar();
+int putchar(int ch);
+
+void output(int n)
+{
+    if (n < 0)
+    {
+        putchar('-');
+        n = -n;
+    }
+    else if (n == 0)
+    {
+        putchar('0');
+        putchar(10);
+        return;
+    }
+    int num[20], idx = 0;
+    while (n != 0)
+    {
+        num[idx] = n % 10;
+        n /= 10;
+        ++idx;
+    }
+    for (--idx; idx >= 0; --idx)
+        putchar(num[idx] + '0');
+    putchar(10);
+}
+
+// Bodies attract each other in a 2D box, in fixed-point integer arithmetic
+// as the language has no floating-point arithmetic
+void step(int *x, int *y, int *vx, int *vy, int n)
+{
+    int i, j, dx, dy, d2;
+    for (i = 0; i < n; ++i)
+        for (j = 0; j < n; ++j)
+        {
+            if (i != j)
+            {
+                dx = x[j] - x[i];
+                dy = y[j] - y[i];
+                d2 = (dx * dx + dy * dy) / 64 + 16;
+                vx[i] += dx * 256 / d2;
+                vy[i] += dy * 256 / d2;
+            }
+        }
+    for (i = 0; i < n; ++i)
+    {
+        // Friction keeps the velocities bounded
+        vx[i] -= vx[i] / 16;
+        vy[i] -= vy[i] / 16;
+        x[i] = (x[i] + vx[i] / 16 + 16384) % 4096;
+        y[i] = (y[i] + vy[i] / 16 + 16384) % 4096;
+    }
+}
+
+void main(void)
+{
+    int x[128], y[128], vx[128], vy[128], i, seed = 1, checksum = 0;
+    for (i = 0; i < 128; ++i)
+    {
+        seed = (seed * 1103 + 12345) % 65536;
+        x[i] = seed % 4096;
+        seed = (seed * 1103 + 12345) % 65536;
+        y[i] = seed % 4096;
+        vx[i] = 0;
+        vy[i] = 0;
+    }
+    for (i = 0; i < 1000; ++i)
+        step(x, y, vx, vy, 128);
+    for (i = 0; i < 128; ++i)
+        checksum = (checksum * 31 + x[i] * 4096 + y[i]) % 1000003;
+    output(checksum);
+}
@@ -0,0 +1,85 @@
+int getchar();
+int putchar(int ch);
+
+void output(int n)
+{
+    if (n < 0)
+    {
+        putchar('-');
+        n = -n;
+    }
+    else if (n == 0)
+    {
+        putchar('0');
+        putchar(10);
+        return;
+    }
+    int num[20], idx = 0;
+    while (n != 0)
+    {
+        num[idx] = n % 10;
+        n /= 10;
+        ++idx;
+    }
+    for (--idx; idx >= 0; --idx)
+        putchar(num[idx] + '0');
+    putchar(10);
+}
+
+void quicksort(int *a, int low, int high)
+{
+    int pivot, i, j, t;
+    while (low < high)
+    {
+        pivot = a[(low + high) / 2];
+        i = low;
+        j = high;
+        while (i <= j)
+        {
+            while (a[i] < pivot)
+                ++i;
+            while (a[j] > pivot)
+                --j;
+            if (i <= j)
+            {
+                t = a[i];
+                a[i] = a[j];
+                a[j] = t;
+                ++i;
+                --j;
+            }
+        }
+        // Recurse into the smaller half, so that the stack stays shallow
+        if (j - low < high - i)
+        {
+            quicksort(a, low, j);
+            low = i;
+        }
+        else
+        {
+            quicksort(a, i, high);
+            high = j;
+        }
+    }
+}
+
+void main(void)
+{
+    int a[1000000], i, round, seed = 1, checksum = 0, sorted = 1;
+    for (round = 0; round < 3; ++round)
+    {
+        for (i = 0; i < 1000000; ++i)
+        {
+            seed = (seed * 1103 + 12345) % 65536;
+            a[i] = seed * 16 + i % 16;
+        }
+        quicksort(a, 0, 999999);
+    }
+    for (i = 1; i < 1000000; ++i)
+        if (a[i - 1] > a[i])
+            sorted = 0;
+    for (i = 0; i < 1000000; i += 1000)
+        checksum = (checksum * 31 + a[i]) % 1000003;
+    output(sorted);
+    output(checksum);
+}
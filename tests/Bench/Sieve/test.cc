@@ -0,0 +1,53 @@
+int getchar();
+int putchar(int ch);
+
+void output(int n)
+{
+    if (n < 0)
+    {
+        putchar('-');
+        n = -n;
+    }
+    else if (n == 0)
+    {
+        putchar('0');
+        putchar(10);
+        return;
+    }
+    int num[20], idx = 0;
+    while (n != 0)
+    {
+        num[idx] = n % 10;
+        n /= 10;
+        ++idx;
+    }
+    for (--idx; idx >= 0; --idx)
+        putchar(num[idx] + '0');
+    putchar(10);
+}
+
+// Counts the primes below n
+int sieve(int *composite, int n)
+{
+    int i, j, count = 0;
+    for (i = 0; i < n; ++i)
+        composite[i] = 0;
+    for (i = 2; i < n; ++i)
+    {
+        if (!composite[i])
+        {
+            ++count;
+            for (j = i + i; j < n; j += i)
+                composite[j] = 1;
+        }
+    }
+    return count;
+}
+
+void main(void)
+{
+    int composite[1000000], i, count;
+    for (i = 0; i < 20; ++i)
+        count = sieve(composite, 1000000);
+    output(count);
+}
@@ -0,0 +1,8 @@
+/* Entry of the C builds of the benchmarks, which are compiled with -Dmain=kernel */
+void kernel(void);
+
+int main(void)
+{
+    kernel();
+    return 0;
+}
@@ -0,0 +1,82 @@
+#!/bin/bash
+
+# Usage: ./throughput-bench.sh [scale] [runs] [options]...
+# Generates programs of several shapes with build/generate, compiles each one
+# `runs` times with the options and prints the lines and tokens per second of
+# the fastest run, with the time of its main phases:
+#   ./throughput-bench.sh 1 3 -O2
+# Scale 1 is about 100000 lines per shape, scale 10 gives the 1M line program,
+# and fractions such as 0.1 give quick runs.
+# The results are also written to build/bench/throughput.json.
+# Set EXE and GENERATE to compare other builds.
+
+EXE=${EXE:-build/exe}
+GENERATE=${GENERATE:-build/generate}
+SCALE=${1:-1}
+RUNS=${2:-3}
+OPTIONS="${@:3}"
+DIR=build/bench
+JSON=$DIR/throughput.json
+
+# $1 times the scale, rounded down
+scaled()
+{
+    awk "BEGIN { printf \"%d\", $SCALE * $1 }"
+}
+
+# Name and generator options of every shape
+SHAPES=(
+    "lines"       "-lines `scaled 100000`"
+    "functions"   "-functions `scaled 10000` -statements 2 -scopes 0 -depth 2"
+    "statements"  "-functions 5 -statements `scaled 15000`"
+    "expressions" "-functions 20 -statements 0 -depth `scaled 1000`"
+    "globals"     "-functions 100 -globals `scaled 50000`"
+    "scopes"      "-functions 20 -statements 0 -scopes `scaled 1000`"
+)
+
+# Wall-clock seconds of a phase in a -time-phases-json file, 0 if it did not run
+phase()
+{
+    local seconds=`grep "\"name\": \"$2\"" $1 | sed 's/.*"wall_seconds": \([-0-9.e]*\).*/\1/'`
+    echo ${seconds:-0}
+}
+
+mkdir -p $DIR || exit 1
+echo "{\"options\": \"$OPTIONS\", \"shapes\": [" > $JSON
+printf "%-12s %9s %9s %9s %11s %11s %8s %8s %8s %8s\n" \
+       Shape Lines Tokens "Time (s)" Lines/s Tokens/s Scan Parse Codegen Optimize
+for ((i = 0; i < ${#SHAPES[@]}; i += 2))
+do
+    name=${SHAPES[i]}
+    src=$DIR/$name.cc
+    $GENERATE ${SHAPES[i + 1]} > $src || exit 1
+    lines=`wc -l < $src`
+    # The token dump has two header lines
+    $EXE -emit-tokens -o $DIR/$name.lex $src || exit 1
+    tokens=$((`wc -l < $DIR/$name.lex` - 2))
+
+    best=
+    for ((run = 0; run < RUNS; ++run))
+    do
+        $EXE $OPTIONS -o /dev/null -time-phases-json $DIR/$name.run.json $src 2>/dev/null || exit 1
+        total=`grep '"total"' $DIR/$name.run.json | sed 's/.*"wall_seconds": \([-0-9.e]*\).*/\1/'`
+        if [ -z "$best" ] || awk "BEGIN { exit !($total < $best) }"
+        then
+            best=$total
+            cp $DIR/$name.run.json $DIR/$name.phases.json
+        fi
+    done
+
+    phases=$DIR/$name.phases.json
+    awk -v name=$name -v lines=$lines -v tokens=$tokens -v total=$best \
+        -v scan=`phase $phases scan` -v parse=`phase $phases parse` \
+        -v codegen=`phase $phases codegen` -v optimize=`phase $phases optimize` 'BEGIN {
+        printf "%-12s %9d %9d %9.3f %11.0f %11.0f %8.3f %8.3f %8.3f %8.3f\n",
+               name, lines, tokens, total, lines / total, tokens / total, scan, parse, codegen, optimize
+    }'
+    [ $i -gt 0 ] && echo "," >> $JSON
+    # The phase times of the fastest run are included as they are
+    printf '  {"name": "%s", "lines": %d, "tokens": %d, "seconds": %s, "compile": %s}' \
+           $name $lines $tokens $best "`tr -s '\n ' ' ' < $phases`" >> $JSON
+done
+echo -e "\n]}" >> $JSON